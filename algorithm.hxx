@@ -7,12 +7,21 @@
 #define MRR_CONCURRENT_ALGORITHM_HXX_
 
 #include <algorithm>
-#include <future>
+#include <cstddef>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <numeric>
 #include <thread>
 #include <type_traits>
 #include <vector>
 
+#include "partitioner.hxx"
+#include "simd.hxx"
+#include "thread_pool.hxx"
+#include "trace.hxx"
+
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
 namespace mrr {
@@ -59,16 +68,338 @@ void replace(Iterator first, Iterator last, T const& old_val, T const& new_val);
 template <typename Iterator, typename Pred, typename T>
 void replace_if(Iterator first, Iterator last, Pred const& pred, T const& new_val);
 
+template <typename Iterator, typename T, typename BinaryOp, typename UnaryOp>
+T transform_reduce(
+  Iterator first, Iterator last,
+  T init, BinaryOp const& reduce, UnaryOp const& transform
+);
+
+template <typename Iterator, typename OutputIterator>
+OutputIterator inclusive_scan(Iterator first, Iterator last, OutputIterator d_first);
+
+template <typename Iterator, typename OutputIterator, typename BinaryOp>
+OutputIterator inclusive_scan(
+  Iterator first, Iterator last, OutputIterator d_first, BinaryOp const& op
+);
+
+template <typename Iterator, typename OutputIterator, typename T>
+OutputIterator exclusive_scan(
+  Iterator first, Iterator last, OutputIterator d_first, T init
+);
+
+template <typename Iterator, typename OutputIterator, typename T, typename BinaryOp>
+OutputIterator exclusive_scan(
+  Iterator first, Iterator last, OutputIterator d_first, T init, BinaryOp const& op
+);
+
+template <typename Iterator, typename OutputIterator, typename Pred>
+OutputIterator copy_if(
+  Iterator first, Iterator last, OutputIterator d_first, Pred const& pred
+);
+
+template <typename Iterator, typename Pred>
+Iterator partition(Iterator first, Iterator last, Pred const& pred);
+
+template <typename Iterator>
+void sort(Iterator first, Iterator last);
+
+template <typename Iterator, typename Compare>
+void sort(Iterator first, Iterator last, Compare const& comp);
+
+template <typename Iterator1, typename Iterator2, typename OutputIterator>
+OutputIterator merge(
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first
+);
+
+template <
+  typename Iterator1, typename Iterator2,
+  typename OutputIterator, typename Compare
+>
+OutputIterator merge(
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first, Compare const& comp
+);
+
+
+// Explicit pool versions.
+template <typename Iterator, typename T>
+T accumulate(thread_pool& pool, Iterator first, Iterator last, T init);
+
+template <typename Iterator, typename T>
+auto count(thread_pool& pool, Iterator first, Iterator last, T const& value)
+  -> typename std::iterator_traits<Iterator>::difference_type;
+
+template <typename Iterator, typename Pred>
+auto count_if(thread_pool& pool, Iterator first, Iterator last, Pred const& pred)
+  -> typename std::iterator_traits<Iterator>::difference_type;
+
+template <typename Iterator, typename T>
+void fill(thread_pool& pool, Iterator first, Iterator last, T const& value);
+
+template <typename Iterator, typename Func>
+void for_each(thread_pool& pool, Iterator first, Iterator last, Func const& func);
+
+template <typename Iterator>
+Iterator max_element(thread_pool& pool, Iterator first, Iterator last);
+
+template <typename Iterator>
+Iterator min_element(thread_pool& pool, Iterator first, Iterator last);
+
+template <typename Iterator, typename T>
+void replace(thread_pool& pool, Iterator first, Iterator last, T const& old_val, T const& new_val);
+
+template <typename Iterator, typename Pred, typename T>
+void replace_if(thread_pool& pool, Iterator first, Iterator last, Pred const& pred, T const& new_val);
+
+
+template <typename Iterator, typename T, typename BinaryOp, typename UnaryOp>
+T transform_reduce(
+  thread_pool& pool,
+  Iterator first, Iterator last,
+  T init, BinaryOp const& reduce, UnaryOp const& transform
+);
+
+template <typename Iterator, typename OutputIterator>
+OutputIterator inclusive_scan(
+  thread_pool& pool, Iterator first, Iterator last, OutputIterator d_first
+);
+
+template <typename Iterator, typename OutputIterator, typename BinaryOp>
+OutputIterator inclusive_scan(
+  thread_pool& pool,
+  Iterator first, Iterator last, OutputIterator d_first, BinaryOp const& op
+);
+
+template <typename Iterator, typename OutputIterator, typename T>
+OutputIterator exclusive_scan(
+  thread_pool& pool,
+  Iterator first, Iterator last, OutputIterator d_first, T init
+);
+
+template <typename Iterator, typename OutputIterator, typename T, typename BinaryOp>
+OutputIterator exclusive_scan(
+  thread_pool& pool,
+  Iterator first, Iterator last, OutputIterator d_first, T init, BinaryOp const& op
+);
+
+template <typename Iterator, typename OutputIterator, typename Pred>
+OutputIterator copy_if(
+  thread_pool& pool,
+  Iterator first, Iterator last, OutputIterator d_first, Pred const& pred
+);
+
+template <typename Iterator, typename Pred>
+Iterator partition(thread_pool& pool, Iterator first, Iterator last, Pred const& pred);
+
+template <typename Iterator>
+void sort(thread_pool& pool, Iterator first, Iterator last);
+
+template <typename Iterator, typename Compare>
+void sort(thread_pool& pool, Iterator first, Iterator last, Compare const& comp);
+
+template <typename Iterator1, typename Iterator2, typename OutputIterator>
+OutputIterator merge(
+  thread_pool& pool,
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first
+);
+
+template <
+  typename Iterator1, typename Iterator2,
+  typename OutputIterator, typename Compare
+>
+OutputIterator merge(
+  thread_pool& pool,
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first, Compare const& comp
+);
+
+
+// Explicit pool and partitioner versions.
+template <typename Partitioner, typename Iterator, typename T>
+T accumulate(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, T init
+);
+
+template <typename Partitioner, typename Iterator, typename T>
+auto count(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, T const& value
+)
+  -> typename std::iterator_traits<Iterator>::difference_type;
+
+template <typename Partitioner, typename Iterator, typename Pred>
+auto count_if(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Pred const& pred
+)
+  -> typename std::iterator_traits<Iterator>::difference_type;
+
+template <typename Partitioner, typename Iterator, typename T>
+void fill(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, T const& value
+);
+
+template <typename Partitioner, typename Iterator, typename Func>
+void for_each(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Func const& func
+);
+
+template <typename Partitioner, typename Iterator>
+Iterator max_element(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last
+);
+
+template <typename Partitioner, typename Iterator>
+Iterator min_element(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last
+);
+
+template <typename Partitioner, typename Iterator, typename T>
+void replace(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, T const& old_val, T const& new_val
+);
+
+template <typename Partitioner, typename Iterator, typename Pred, typename T>
+void replace_if(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Pred const& pred, T const& new_val
+);
+
+template <
+  typename Partitioner, typename Iterator,
+  typename T, typename BinaryOp, typename UnaryOp
+>
+auto transform_reduce(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last,
+  T init, BinaryOp const& reduce, UnaryOp const& transform
+)
+  -> typename std::enable_if<is_partitioner<Partitioner>::value, T>::type;
+
+template <
+  typename Partitioner, typename Iterator,
+  typename OutputIterator, typename BinaryOp
+>
+auto inclusive_scan(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, OutputIterator d_first, BinaryOp const& op
+)
+  -> typename std::enable_if<
+       is_partitioner<Partitioner>::value, OutputIterator
+     >::type;
+
+template <
+  typename Partitioner, typename Iterator,
+  typename OutputIterator, typename T, typename BinaryOp
+>
+auto exclusive_scan(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, OutputIterator d_first, T init, BinaryOp const& op
+)
+  -> typename std::enable_if<
+       is_partitioner<Partitioner>::value, OutputIterator
+     >::type;
+
+template <
+  typename Partitioner, typename Iterator,
+  typename OutputIterator, typename Pred
+>
+auto copy_if(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, OutputIterator d_first, Pred const& pred
+)
+  -> typename std::enable_if<
+       is_partitioner<Partitioner>::value, OutputIterator
+     >::type;
+
+template <typename Partitioner, typename Iterator, typename Pred>
+auto partition(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Pred const& pred
+)
+  -> typename std::enable_if<is_partitioner<Partitioner>::value, Iterator>::type;
+
+template <typename Partitioner, typename Iterator, typename Compare>
+auto sort(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Compare const& comp
+)
+  -> typename std::enable_if<is_partitioner<Partitioner>::value, void>::type;
+
+template <
+  typename Partitioner, typename Iterator1, typename Iterator2,
+  typename OutputIterator, typename Compare
+>
+auto merge(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first, Compare const& comp
+)
+  -> typename std::enable_if<
+       is_partitioner<Partitioner>::value, OutputIterator
+     >::type;
+
 
 
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 // Implementations
+// Blocks of contiguous arithmetic ranges go to the SIMD kernels in
+// simd.hxx when the operation is on the element type itself.
+template <typename Iterator, typename T = void>
+struct use_simd
+  : std::integral_constant<
+      bool,
+      simd::is_simd_range<Iterator>::value
+        && (std::is_void<T>::value
+            || std::is_same<
+                 T, typename std::iterator_traits<Iterator>::value_type
+               >::value)
+    >
+{
+};
+
+template <typename Iterator>
+auto simd_pointer(Iterator it)
+  -> typename std::iterator_traits<Iterator>::value_type const*
+{
+  return std::addressof(*it);
+}
+
+
+// Blocks are never empty; accumulate() handles the empty range so init
+// is only added once, in result(). Each block starts its sum from its
+// first element, so this is only used when T can be initialized from
+// one, see accumulate_blocks.
 template <typename Iterator, typename T>
 struct parallel_accumulate_impl
 {
-  static T apply(Iterator first, Iterator last, T const& init)
+  static T apply(Iterator first, Iterator last, T const&)
   {
-    return std::accumulate(first,last,init);
+    return apply_helper(first, last, use_simd<Iterator,T>());
+  }
+
+  static T apply_helper(Iterator first, Iterator last, std::true_type)
+  {
+    return simd::sum(simd_pointer(first), simd_pointer(first) + (last - first));
+  }
+
+  static T apply_helper(Iterator first, Iterator last, std::false_type)
+  {
+    T sum = *first;
+    return std::accumulate(++first,last,sum);
   }
 
   template <typename ResultIter>
@@ -85,6 +416,23 @@ struct parallel_count_impl
   using return_type = typename std::iterator_traits<Iterator>::difference_type;
 
   static return_type apply(Iterator first, Iterator last, T const& t)
+  {
+    return apply_helper(first, last, t, use_simd<Iterator,T>());
+  }
+
+  static return_type apply_helper(
+    Iterator first, Iterator last, T const& t, std::true_type
+  )
+  {
+    if(first == last)
+      return 0;
+
+    return simd::count(simd_pointer(first), simd_pointer(first) + (last - first), t);
+  }
+
+  static return_type apply_helper(
+    Iterator first, Iterator last, T const& t, std::false_type
+  )
   {
     return std::count(first,last,t);
   }
@@ -92,7 +440,7 @@ struct parallel_count_impl
   template <typename ResultIter>
   static return_type result(ResultIter first, ResultIter last, T const&)
   {
-    return mrr::concurrent::accumulate(first,last,0);
+    return std::accumulate(first,last,return_type(0));
   }
 };
 
@@ -110,7 +458,7 @@ struct parallel_count_if_impl
   template <typename ResultIter>
   static return_type result(ResultIter first, ResultIter last, Pred const&)
   {
-    return mrr::concurrent::accumulate(first,last,0);
+    return std::accumulate(first,last,return_type(0));
   }
 };
 
@@ -141,6 +489,20 @@ template <typename Iterator>
 struct parallel_max_element_impl
 {
   static Iterator apply(Iterator first, Iterator last)
+  {
+    return apply_helper(first, last, use_simd<Iterator>());
+  }
+
+  static Iterator apply_helper(Iterator first, Iterator last, std::true_type)
+  {
+    if(first == last)
+      return last;
+
+    auto const base = simd_pointer(first);
+    return first + (simd::max_element(base, base + (last - first)) - base);
+  }
+
+  static Iterator apply_helper(Iterator first, Iterator last, std::false_type)
   {
     return std::max_element(first,last);
   }
@@ -148,7 +510,10 @@ struct parallel_max_element_impl
   template <typename ResultIter>
   static Iterator result(ResultIter first, ResultIter last)
   {
-    return std::max_element(first,last);
+    return *std::max_element(
+      first,last,
+      [](Iterator const& a, Iterator const& b) { return *a < *b; }
+    );
   }
 };
 
@@ -158,6 +523,20 @@ template <typename Iterator>
 struct parallel_min_element_impl
 {
   static Iterator apply(Iterator first, Iterator last)
+  {
+    return apply_helper(first, last, use_simd<Iterator>());
+  }
+
+  static Iterator apply_helper(Iterator first, Iterator last, std::true_type)
+  {
+    if(first == last)
+      return last;
+
+    auto const base = simd_pointer(first);
+    return first + (simd::min_element(base, base + (last - first)) - base);
+  }
+
+  static Iterator apply_helper(Iterator first, Iterator last, std::false_type)
   {
     return std::min_element(first,last);
   }
@@ -165,7 +544,10 @@ struct parallel_min_element_impl
   template <typename ResultIter>
   static Iterator result(ResultIter first, ResultIter last)
   {
-    return std::min_element(first,last);
+    return *std::min_element(
+      first,last,
+      [](Iterator const& a, Iterator const& b) { return *a < *b; }
+    );
   }
 };
 
@@ -187,15 +569,337 @@ struct parallel_replace_if_impl
 {
   static void apply(Iterator first, Iterator last, Pred const& pred, T const& new_val)
   {
-    std::replace(first,last,pred,new_val);
+    std::replace_if(first,last,pred,new_val);
+  }
+};
+
+
+// Blocks are never empty; transform_reduce() handles the empty range.
+template <typename Iterator, typename T, typename BinaryOp, typename UnaryOp>
+struct parallel_transform_reduce_impl
+{
+  static T apply(
+    Iterator first, Iterator last,
+    T const&, BinaryOp const& reduce, UnaryOp const& transform
+  )
+  {
+    T sum = transform(*first);
+    for(++first; first != last; ++first)
+      sum = reduce(sum, transform(*first));
+    return sum;
+  }
+
+  template <typename ResultIter>
+  static T result(
+    ResultIter first, ResultIter last,
+    T const& init, BinaryOp const& reduce, UnaryOp const&
+  )
+  {
+    return std::accumulate(first,last,init,reduce);
   }
 };
 
 
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Implementations - two pass algorithms
+//
+// These run in_parallel_scan. apply() summarises each (non-empty) block,
+// the summaries are folded into an exclusive prefix with combine(), then
+// scan() writes the output of each block given the prefix of all blocks
+// before it (null for the first block) and the block's offset into the
+// input. scan() returns the end of the block's output.
+template <typename Iterator, typename OutputIterator, typename BinaryOp>
+struct parallel_inclusive_scan_impl
+{
+  using difference_type = typename std::iterator_traits<Iterator>::difference_type;
+  using summary_type = typename std::iterator_traits<Iterator>::value_type;
+
+  static summary_type apply(Iterator first, Iterator last, BinaryOp const& op)
+  {
+    summary_type sum = *first;
+    for(++first; first != last; ++first)
+      sum = op(sum, *first);
+    return sum;
+  }
+
+  static summary_type combine(
+    summary_type const& lhs, summary_type const& rhs, BinaryOp const& op
+  )
+  {
+    return op(lhs, rhs);
+  }
+
+  static OutputIterator scan(
+    Iterator first, Iterator last,
+    OutputIterator d_first, difference_type offset,
+    summary_type const* carry, BinaryOp const& op
+  )
+  {
+    std::advance(d_first, offset);
+    if(first == last)
+      return d_first;
+
+    summary_type sum = carry ? op(*carry, *first) : summary_type(*first);
+    *d_first = sum;
+
+    for(++first, ++d_first; first != last; ++first, ++d_first)
+    {
+      sum = op(sum, *first);
+      *d_first = sum;
+    }
+    return d_first;
+  }
+};
+
+
+template <typename Iterator, typename OutputIterator, typename T, typename BinaryOp>
+struct parallel_exclusive_scan_impl
+{
+  using difference_type = typename std::iterator_traits<Iterator>::difference_type;
+  using summary_type = T;
+
+  static T apply(Iterator first, Iterator last, T const&, BinaryOp const& op)
+  {
+    T sum = *first;
+    for(++first; first != last; ++first)
+      sum = op(sum, *first);
+    return sum;
+  }
+
+  static T combine(T const& lhs, T const& rhs, T const&, BinaryOp const& op)
+  {
+    return op(lhs, rhs);
+  }
+
+  static OutputIterator scan(
+    Iterator first, Iterator last,
+    OutputIterator d_first, difference_type offset,
+    T const* carry, T const& init, BinaryOp const& op
+  )
+  {
+    std::advance(d_first, offset);
+
+    T sum = carry ? op(init, *carry) : init;
+    for(; first != last; ++first, ++d_first)
+    {
+      T next = op(sum, *first);
+      *d_first = std::move(sum);
+      sum = std::move(next);
+    }
+    return d_first;
+  }
+};
+
+
+// Stream compaction: the block summaries are counts of selected
+// elements, so the prefix is where each block starts writing.
+template <typename Iterator, typename OutputIterator, typename Pred>
+struct parallel_copy_if_impl
+{
+  using difference_type = typename std::iterator_traits<Iterator>::difference_type;
+  using summary_type = difference_type;
+
+  static difference_type apply(Iterator first, Iterator last, Pred const& pred)
+  {
+    return std::count_if(first,last,pred);
+  }
+
+  static difference_type combine(
+    difference_type lhs, difference_type rhs, Pred const&
+  )
+  {
+    return lhs + rhs;
+  }
+
+  static OutputIterator scan(
+    Iterator first, Iterator last,
+    OutputIterator d_first, difference_type,
+    difference_type const* carry, Pred const& pred
+  )
+  {
+    if(carry)
+      std::advance(d_first, *carry);
+    return std::copy_if(first,last,d_first,pred);
+  }
+};
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Block scheduling.
+
+// One result per block, each slot aligned to its own cache line so
+// blocks finishing at the same time do not false-share. A slot holds
+// its value like an optional, so T need not be default constructible.
+std::size_t const cache_line_size = 64;
+
+template <typename T>
+struct alignas(cache_line_size) padded_result
+{
+  alignas(T) unsigned char storage[sizeof(T)];
+  bool has_value;
+};
+
+
+// A fixed number of padded_result slots. The storage is aligned by hand
+// because neither new nor std::vector honours alignment above
+// alignof(std::max_align_t) before C++17.
+template <typename T>
+class padded_slots
+{
+public:
+  explicit padded_slots(std::size_t n)
+    : size_(n)
+  {
+    std::size_t space = n * sizeof(slot) + cache_line_size;
+    memory_ = ::operator new(space);
+    void* p = memory_;
+    slots_ = static_cast<slot*>(std::align(cache_line_size, n * sizeof(slot), p, space));
+    for(std::size_t i = 0; i != n; ++i)
+      ::new (static_cast<void*>(slots_ + i)) slot{ {}, false };
+  }
+
+  padded_slots(padded_slots const&) = delete;
+  padded_slots& operator =(padded_slots const&) = delete;
+
+  ~padded_slots()
+  {
+    for(std::size_t i = 0; i != size_; ++i)
+      if(slots_[i].has_value)
+        (*this)[i].~T();
+    ::operator delete(memory_);
+  }
+
+  // Sets slot i, constructing its value the first time.
+  template <typename U>
+  void set(std::size_t i, U&& value)
+  {
+    if(slots_[i].has_value)
+      (*this)[i] = std::forward<U>(value);
+    else
+    {
+      ::new (static_cast<void*>(slots_[i].storage)) T(std::forward<U>(value));
+      slots_[i].has_value = true;
+    }
+  }
+
+  // The value of slot i, which must have been set.
+  T& operator [](std::size_t i)
+  {
+    return *reinterpret_cast<T*>(slots_[i].storage);
+  }
+
+private:
+  using slot = padded_result<T>;
+
+  void* memory_;
+  slot* slots_;
+  std::size_t size_;
+};
+
+
+// Offset of the start of a block when a range of the given length is
+// split into num_blocks (near) equal blocks.
+template <typename Difference>
+Difference block_offset(Difference length, std::size_t block, std::size_t num_blocks)
+{
+  return length * static_cast<Difference>(block)
+    / static_cast<Difference>(num_blocks);
+}
+
+
+// Hands the blocks [lo,hi) of a range to the pool by recursive halving:
+// the upper half is queued as a task and the lower half split further
+// on the current thread, so the largest pieces are the first to be
+// stolen by idle workers.
+template <typename Iterator, typename BlockFunc>
+class block_splitter
+{
+public:
+  using difference_type = typename std::iterator_traits<Iterator>::difference_type;
+
+  block_splitter(
+    task_group& tasks,
+    difference_type length,
+    std::size_t num_blocks,
+    BlockFunc const& func
+  )
+    : tasks_(tasks), length_(length), num_blocks_(num_blocks), func_(func)
+  {
+  }
+
+  void operator ()(std::size_t lo, std::size_t hi, Iterator first, Iterator last) const
+  {
+    while(hi - lo > 1)
+    {
+      std::size_t const mid = lo + (hi - lo)/2;
+
+      Iterator middle = first;
+      std::advance(
+        middle,
+        block_offset(length_, mid, num_blocks_)
+          - block_offset(length_, lo, num_blocks_)
+      );
+
+      tasks_.run([this, mid, hi, middle, last]() {
+        (*this)(mid, hi, middle, last);
+      });
+
+      hi = mid;
+      last = middle;
+    }
+
+    MRR_TRACE_SCOPE_ARG("block", "index", static_cast<std::int64_t>(lo));
+    func_(lo, first, last);
+  }
+
+private:
+  task_group& tasks_;
+  difference_type length_;
+  std::size_t num_blocks_;
+  BlockFunc const& func_;
+};
+
+
+// Split [first,last) into num_blocks blocks and call
+// func(block_index, block_first, block_last) for each one on the pool.
+// With MRR_TRACE defined the call and each block are recorded as trace
+// zones, so block imbalance shows up in the trace.
+template <typename Iterator, typename BlockFunc>
+void run_blocks(
+  thread_pool& pool,
+  Iterator first, Iterator last,
+  typename std::iterator_traits<Iterator>::difference_type length,
+  std::size_t num_blocks,
+  BlockFunc const& func
+)
+{
+  MRR_TRACE_SCOPE_ARG("in_parallel", "blocks", static_cast<std::int64_t>(num_blocks));
+
+  task_group tasks(pool);
+  block_splitter<Iterator,BlockFunc> split(tasks, length, num_blocks, func);
+
+  split(0, num_blocks, first, last);
+  tasks.wait();
+}
+
+
+
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 // The core algorithm - non-void return version
-template <typename Algorithm, typename Iterator, typename... Args>
-auto in_parallel(Iterator first, Iterator last, Args&&... args)
+//
+// Ranges up to the partitioner's sequential cutoff are processed as a
+// single block on the calling thread. Otherwise the range is split into
+// the partitioner's number of blocks, each block writes its result into
+// its own slot and the slots are combined with Algorithm::result.
+template <typename Algorithm, typename Partitioner, typename Iterator, typename... Args>
+auto in_parallel(
+  thread_pool& pool,
+  Partitioner const& partitioner,
+  Iterator first, Iterator last,
+  Args&&... args
+)
   -> typename std::enable_if<
        !std::is_void<decltype(
                        Algorithm::apply(first,last,std::forward<Args>(args)...)
@@ -211,37 +915,28 @@ auto in_parallel(Iterator first, Iterator last, Args&&... args)
 
   const difference_type length = std::distance(first,last);
 
-  if(length == 0)
-    return 0;
-
-  const unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
-  const difference_type block_size = length/num_threads;
-
-  std::vector<std::future<return_type> > threads(num_threads - 1);
-  std::vector<return_type> results(num_threads);
-
-  iterator block_first = first;
-  for(unsigned i = 0; i < (num_threads - 1); ++i)
+  if(static_cast<std::size_t>(length) <= partitioner.sequential_cutoff())
   {
-    iterator block_last = block_first;
-    std::advance(block_last, block_size);
-
-    threads[i] = std::async(
-      std::launch::async,
-      Algorithm::apply,
-      block_first, block_last,
-      std::forward<Args>(args)...
-    );
-    block_first = block_last;
+    return_type result = Algorithm::apply(first,last,args...);
+    return Algorithm::result(&result, &result + 1, std::forward<Args>(args)...);
   }
 
-  results[num_threads-1] = Algorithm::apply(
-    block_first,last,
-    std::forward<Args>(args)...
+  const std::size_t num_blocks =
+    partitioner.num_blocks(static_cast<std::size_t>(length), pool.size() + 1);
+
+  padded_slots<return_type> slots(num_blocks);
+
+  run_blocks(
+    pool, first, last, length, num_blocks,
+    [&](std::size_t i, iterator block_first, iterator block_last) {
+      slots.set(i, Algorithm::apply(block_first, block_last, args...));
+    }
   );
 
-  for(unsigned i = 0; i < (num_threads - 1); ++i)
-    results[i] = threads[i].get();
+  std::vector<return_type> results;
+  results.reserve(num_blocks);
+  for(std::size_t i = 0; i != num_blocks; ++i)
+    results.push_back(std::move(slots[i]));
 
   return Algorithm::result(begin(results), end(results), std::forward<Args>(args)...);
 }
@@ -250,8 +945,13 @@ auto in_parallel(Iterator first, Iterator last, Args&&... args)
 
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 // The core algorithm - void return version
-template <typename Algorithm, typename Iterator, typename... Args>
-auto in_parallel(Iterator first, Iterator last, Args&&... args)
+template <typename Algorithm, typename Partitioner, typename Iterator, typename... Args>
+auto in_parallel(
+  thread_pool& pool,
+  Partitioner const& partitioner,
+  Iterator first, Iterator last,
+  Args&&... args
+)
   -> typename std::enable_if<
        std::is_void<decltype(
                       Algorithm::apply(first,last,std::forward<Args>(args)...)
@@ -264,35 +964,257 @@ auto in_parallel(Iterator first, Iterator last, Args&&... args)
 
   const difference_type length = std::distance(first,last);
 
-  if(length == 0)
-    return;
+  if(static_cast<std::size_t>(length) <= partitioner.sequential_cutoff())
+    return Algorithm::apply(first,last,args...);
+
+  const std::size_t num_blocks =
+    partitioner.num_blocks(static_cast<std::size_t>(length), pool.size() + 1);
 
-  const unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
-  const difference_type block_size = length/num_threads;
+  run_blocks(
+    pool, first, last, length, num_blocks,
+    [&](std::size_t, iterator block_first, iterator block_last) {
+      Algorithm::apply(block_first, block_last, args...);
+    }
+  );
+}
 
-  std::vector<std::thread> threads(num_threads - 1);
 
-  iterator block_first = first;
-  for(unsigned i = 0; i < (num_threads - 1); ++i)
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// The core algorithm - two pass (scan) version
+//
+// Both passes use the same blocks. Between them the block summaries are
+// turned into an exclusive prefix on the calling thread; there are only
+// ever a few blocks per thread so this is cheap.
+template <
+  typename Algorithm, typename Partitioner,
+  typename Iterator, typename OutputIterator, typename... Args
+>
+OutputIterator in_parallel_scan(
+  thread_pool& pool,
+  Partitioner const& partitioner,
+  Iterator first, Iterator last,
+  OutputIterator d_first,
+  Args&&... args
+)
+{
+  using difference_type = typename std::iterator_traits<Iterator>::difference_type;
+  using iterator = Iterator;
+  using summary_type = typename Algorithm::summary_type;
+
+  const difference_type length = std::distance(first,last);
+
+  if(static_cast<std::size_t>(length) <= partitioner.sequential_cutoff())
+    return Algorithm::scan(first,last,d_first,0,nullptr,args...);
+
+  const std::size_t num_blocks =
+    partitioner.num_blocks(static_cast<std::size_t>(length), pool.size() + 1);
+
+  padded_slots<summary_type> prefix(num_blocks);
+
+  run_blocks(
+    pool, first, last, length, num_blocks,
+    [&](std::size_t i, iterator block_first, iterator block_last) {
+      prefix.set(i, Algorithm::apply(block_first, block_last, args...));
+    }
+  );
+
+  // Block i's slot becomes the combined summary of blocks [0,i).
+  summary_type running = prefix[0];
+  for(std::size_t i = 1; i < num_blocks; ++i)
   {
-    iterator block_last = block_first;
-    std::advance(block_last, block_size);
+    summary_type block = std::move(prefix[i]);
+    prefix[i] = running;
+    running = Algorithm::combine(running, block, args...);
+  }
 
-    threads[i] = std::thread(
-      Algorithm::apply,
-      block_first, block_last,
-      std::forward<Args>(args)...
-    );
-    block_first = block_last;
+  OutputIterator d_last = d_first;
+
+  run_blocks(
+    pool, first, last, length, num_blocks,
+    [&](std::size_t i, iterator block_first, iterator block_last) {
+      OutputIterator block_end = Algorithm::scan(
+        block_first, block_last,
+        d_first, block_offset(length, i, num_blocks),
+        i == 0 ? nullptr : &prefix[i],
+        args...
+      );
+
+      if(i == num_blocks - 1)
+        d_last = block_end;
+    }
+  );
+
+  return d_last;
+}
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Parallel merge.
+//
+// Splits the merge at the middle of the longer input and the matching
+// bound in the shorter one, queueing the upper half as a task, until the
+// pieces are no longer than grain. Equal elements from the first range
+// stay ahead of those from the second, as with std::merge. Requires
+// random access iterators and grain >= 2.
+template <
+  typename Iterator1, typename Iterator2,
+  typename OutputIterator, typename Compare
+>
+void merge_blocks(
+  task_group& tasks,
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first,
+  Compare const& comp,
+  std::ptrdiff_t grain
+)
+{
+  for(;;)
+  {
+    const std::ptrdiff_t length1 = last1 - first1;
+    const std::ptrdiff_t length2 = last2 - first2;
+
+    if(length1 + length2 <= grain)
+    {
+      std::merge(first1,last1,first2,last2,d_first,comp);
+      return;
+    }
+
+    Iterator1 middle1;
+    Iterator2 middle2;
+
+    if(length1 >= length2)
+    {
+      middle1 = first1 + length1/2;
+      middle2 = std::lower_bound(first2,last2,*middle1,comp);
+    }
+    else
+    {
+      middle2 = first2 + length2/2;
+      middle1 = std::upper_bound(first1,last1,*middle2,comp);
+    }
+
+    OutputIterator d_middle = d_first + (middle1 - first1) + (middle2 - first2);
+
+    tasks.run([=, &tasks, &comp]() {
+      merge_blocks(tasks, middle1, last1, middle2, last2, d_middle, comp, grain);
+    });
+
+    last1 = middle1;
+    last2 = middle2;
+  }
+}
+
+
+// One round of the bottom-up merge sort: merges runs [bounds[i],bounds[i+1])
+// and [bounds[i+1],bounds[i+2]) of src into dst and returns the bounds of
+// the merged runs.
+template <typename SrcIterator, typename DstIterator, typename Compare>
+std::vector<std::ptrdiff_t> merge_round(
+  thread_pool& pool,
+  SrcIterator src, DstIterator dst,
+  std::vector<std::ptrdiff_t> const& bounds,
+  Compare const& comp,
+  std::ptrdiff_t grain
+)
+{
+  std::vector<std::ptrdiff_t> merged;
+  task_group tasks(pool);
+
+  std::size_t i = 0;
+  for(; i + 2 < bounds.size(); i += 2)
+  {
+    std::ptrdiff_t const run_first = bounds[i];
+    std::ptrdiff_t const run_middle = bounds[i+1];
+    std::ptrdiff_t const run_last = bounds[i+2];
+
+    tasks.run([=, &tasks, &comp]() {
+      merge_blocks(
+        tasks,
+        std::make_move_iterator(src + run_first),
+        std::make_move_iterator(src + run_middle),
+        std::make_move_iterator(src + run_middle),
+        std::make_move_iterator(src + run_last),
+        dst + run_first,
+        comp, grain
+      );
+    });
+    merged.push_back(run_first);
   }
 
-  Algorithm::apply(
-    block_first,last,
+  // An odd run out is moved across unchanged.
+  if(i + 1 < bounds.size())
+  {
+    std::ptrdiff_t const run_first = bounds[i];
+    std::ptrdiff_t const run_last = bounds[i+1];
+
+    tasks.run([=]() {
+      std::move(src + run_first, src + run_last, dst + run_first);
+    });
+    merged.push_back(run_first);
+  }
+
+  merged.push_back(bounds.back());
+  tasks.wait();
+  return merged;
+}
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Run with the default partitioner.
+template <typename Algorithm, typename Iterator, typename... Args>
+auto in_parallel(thread_pool& pool, Iterator first, Iterator last, Args&&... args)
+  -> decltype(Algorithm::apply(first,last,std::forward<Args>(args)...))
+{
+  return in_parallel<Algorithm>(
+    pool, adaptive_partitioner(),
+    first,last,
+    std::forward<Args>(args)...
+  );
+}
+
+
+// Run on the process-wide pool with the default partitioner.
+template <typename Algorithm, typename Iterator, typename... Args>
+auto in_parallel(Iterator first, Iterator last, Args&&... args)
+  -> decltype(Algorithm::apply(first,last,std::forward<Args>(args)...))
+{
+  return in_parallel<Algorithm>(
+    default_pool(),
+    first,last,
     std::forward<Args>(args)...
   );
+}
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Accumulate dispatch.
+//
+// When T cannot be initialized from an element (chars into a string,
+// say) a block has nothing to start its sum from but init, which must
+// only be added once, so the range is summed on the calling thread.
+template <typename Iterator, typename T>
+struct accumulate_blocks
+  : std::is_convertible<
+      typename std::iterator_traits<Iterator>::value_type const&, T
+    >
+{
+};
+
+template <typename Iterator, typename T, typename... Pool>
+T accumulate_dispatch(std::true_type, Iterator first, Iterator last, T init, Pool&... pool)
+{
+  return in_parallel<parallel_accumulate_impl<Iterator,T> >(pool...,first,last,init);
+}
 
-  for(std::thread& t : threads)
-    t.join();
+template <typename Iterator, typename T, typename... Pool>
+T accumulate_dispatch(std::false_type, Iterator first, Iterator last, T init, Pool&...)
+{
+  return std::accumulate(first,last,init);
 }
 
 
@@ -302,7 +1224,10 @@ auto in_parallel(Iterator first, Iterator last, Args&&... args)
 template <typename Iterator, typename T>
 T accumulate(Iterator first, Iterator last, T init)
 {
-  return in_parallel<parallel_accumulate_impl<Iterator,T> >(first,last,init);
+  if(first == last)
+    return init;
+
+  return accumulate_dispatch(accumulate_blocks<Iterator,T>(), first, last, init);
 }
 
 template <typename Iterator, typename T>
@@ -334,13 +1259,13 @@ void for_each(Iterator first, Iterator last, Func const& func)
 template <typename Iterator>
 Iterator max_element(Iterator first, Iterator last)
 {
-  in_parallel<parallel_max_element_impl<Iterator> >(first,last);
+  return in_parallel<parallel_max_element_impl<Iterator> >(first,last);
 }
 
 template <typename Iterator>
 Iterator min_element(Iterator first, Iterator last)
 {
-  in_parallel<parallel_min_element_impl<Iterator> >(first,last);
+  return in_parallel<parallel_min_element_impl<Iterator> >(first,last);
 }
 
 template <typename Iterator, typename T>
@@ -356,6 +1281,609 @@ void replace_if(Iterator first, Iterator last, Pred const& pred, T const& new_va
 }
 
 
+
+template <typename Iterator, typename T, typename BinaryOp, typename UnaryOp>
+T transform_reduce(
+  Iterator first, Iterator last,
+  T init, BinaryOp const& reduce, UnaryOp const& transform
+)
+{
+  return mrr::concurrent::transform_reduce(
+    default_pool(), first, last, init, reduce, transform
+  );
+}
+
+template <typename Iterator, typename OutputIterator>
+OutputIterator inclusive_scan(Iterator first, Iterator last, OutputIterator d_first)
+{
+  return mrr::concurrent::inclusive_scan(default_pool(), first, last, d_first);
+}
+
+template <typename Iterator, typename OutputIterator, typename BinaryOp>
+OutputIterator inclusive_scan(
+  Iterator first, Iterator last, OutputIterator d_first, BinaryOp const& op
+)
+{
+  return mrr::concurrent::inclusive_scan(default_pool(), first, last, d_first, op);
+}
+
+template <typename Iterator, typename OutputIterator, typename T>
+OutputIterator exclusive_scan(
+  Iterator first, Iterator last, OutputIterator d_first, T init
+)
+{
+  return mrr::concurrent::exclusive_scan(default_pool(), first, last, d_first, init);
+}
+
+template <typename Iterator, typename OutputIterator, typename T, typename BinaryOp>
+OutputIterator exclusive_scan(
+  Iterator first, Iterator last, OutputIterator d_first, T init, BinaryOp const& op
+)
+{
+  return mrr::concurrent::exclusive_scan(
+    default_pool(), first, last, d_first, init, op
+  );
+}
+
+template <typename Iterator, typename OutputIterator, typename Pred>
+OutputIterator copy_if(
+  Iterator first, Iterator last, OutputIterator d_first, Pred const& pred
+)
+{
+  return mrr::concurrent::copy_if(default_pool(), first, last, d_first, pred);
+}
+
+template <typename Iterator, typename Pred>
+Iterator partition(Iterator first, Iterator last, Pred const& pred)
+{
+  return mrr::concurrent::partition(default_pool(), first, last, pred);
+}
+
+template <typename Iterator>
+void sort(Iterator first, Iterator last)
+{
+  mrr::concurrent::sort(default_pool(), first, last);
+}
+
+template <typename Iterator, typename Compare>
+void sort(Iterator first, Iterator last, Compare const& comp)
+{
+  mrr::concurrent::sort(default_pool(), first, last, comp);
+}
+
+template <typename Iterator1, typename Iterator2, typename OutputIterator>
+OutputIterator merge(
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first
+)
+{
+  return mrr::concurrent::merge(
+    default_pool(), first1, last1, first2, last2, d_first
+  );
+}
+
+template <
+  typename Iterator1, typename Iterator2,
+  typename OutputIterator, typename Compare
+>
+OutputIterator merge(
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first, Compare const& comp
+)
+{
+  return mrr::concurrent::merge(
+    default_pool(), first1, last1, first2, last2, d_first, comp
+  );
+}
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Calling functions - explicit pool versions
+template <typename Iterator, typename T>
+T accumulate(thread_pool& pool, Iterator first, Iterator last, T init)
+{
+  if(first == last)
+    return init;
+
+  return accumulate_dispatch(accumulate_blocks<Iterator,T>(), first, last, init, pool);
+}
+
+template <typename Iterator, typename T>
+auto count(thread_pool& pool, Iterator first, Iterator last, T const& value)
+  -> typename std::iterator_traits<Iterator>::difference_type
+{
+  return in_parallel<parallel_count_impl<Iterator,T> >(pool,first,last,value);
+}
+
+template <typename Iterator, typename Pred>
+auto count_if(thread_pool& pool, Iterator first, Iterator last, Pred const& pred)
+  -> typename std::iterator_traits<Iterator>::difference_type
+{
+  return in_parallel<parallel_count_if_impl<Iterator,Pred> >(pool,first,last,pred);
+}
+
+template <typename Iterator, typename T>
+void fill(thread_pool& pool, Iterator first, Iterator last, T const& value)
+{
+  in_parallel<parallel_fill_impl<Iterator,T> >(pool,first,last,value);
+}
+
+template <typename Iterator, typename Func>
+void for_each(thread_pool& pool, Iterator first, Iterator last, Func const& func)
+{
+  in_parallel<parallel_for_each_impl<Iterator,Func> >(pool,first,last,func);
+}
+
+template <typename Iterator>
+Iterator max_element(thread_pool& pool, Iterator first, Iterator last)
+{
+  return in_parallel<parallel_max_element_impl<Iterator> >(pool,first,last);
+}
+
+template <typename Iterator>
+Iterator min_element(thread_pool& pool, Iterator first, Iterator last)
+{
+  return in_parallel<parallel_min_element_impl<Iterator> >(pool,first,last);
+}
+
+template <typename Iterator, typename T>
+void replace(thread_pool& pool, Iterator first, Iterator last, T const& old_val, T const& new_val)
+{
+  in_parallel<parallel_replace_impl<Iterator,T> >(pool,first,last,old_val,new_val);
+}
+
+template <typename Iterator, typename Pred, typename T>
+void replace_if(thread_pool& pool, Iterator first, Iterator last, Pred const& pred, T const& new_val)
+{
+  in_parallel<parallel_replace_if_impl<Iterator,Pred,T> >(pool,first,last,pred,new_val);
+}
+
+
+template <typename Iterator, typename T, typename BinaryOp, typename UnaryOp>
+T transform_reduce(
+  thread_pool& pool,
+  Iterator first, Iterator last,
+  T init, BinaryOp const& reduce, UnaryOp const& transform
+)
+{
+  return mrr::concurrent::transform_reduce(
+    pool, adaptive_partitioner(), first, last, init, reduce, transform
+  );
+}
+
+template <typename Iterator, typename OutputIterator>
+OutputIterator inclusive_scan(
+  thread_pool& pool, Iterator first, Iterator last, OutputIterator d_first
+)
+{
+  using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+  return mrr::concurrent::inclusive_scan(
+    pool, adaptive_partitioner(), first, last, d_first, std::plus<value_type>()
+  );
+}
+
+template <typename Iterator, typename OutputIterator, typename BinaryOp>
+OutputIterator inclusive_scan(
+  thread_pool& pool,
+  Iterator first, Iterator last, OutputIterator d_first, BinaryOp const& op
+)
+{
+  return mrr::concurrent::inclusive_scan(
+    pool, adaptive_partitioner(), first, last, d_first, op
+  );
+}
+
+template <typename Iterator, typename OutputIterator, typename T>
+OutputIterator exclusive_scan(
+  thread_pool& pool,
+  Iterator first, Iterator last, OutputIterator d_first, T init
+)
+{
+  return mrr::concurrent::exclusive_scan(
+    pool, adaptive_partitioner(), first, last, d_first, init, std::plus<T>()
+  );
+}
+
+template <typename Iterator, typename OutputIterator, typename T, typename BinaryOp>
+OutputIterator exclusive_scan(
+  thread_pool& pool,
+  Iterator first, Iterator last, OutputIterator d_first, T init, BinaryOp const& op
+)
+{
+  return mrr::concurrent::exclusive_scan(
+    pool, adaptive_partitioner(), first, last, d_first, init, op
+  );
+}
+
+template <typename Iterator, typename OutputIterator, typename Pred>
+OutputIterator copy_if(
+  thread_pool& pool,
+  Iterator first, Iterator last, OutputIterator d_first, Pred const& pred
+)
+{
+  return mrr::concurrent::copy_if(
+    pool, adaptive_partitioner(), first, last, d_first, pred
+  );
+}
+
+template <typename Iterator, typename Pred>
+Iterator partition(thread_pool& pool, Iterator first, Iterator last, Pred const& pred)
+{
+  return mrr::concurrent::partition(pool, adaptive_partitioner(), first, last, pred);
+}
+
+template <typename Iterator>
+void sort(thread_pool& pool, Iterator first, Iterator last)
+{
+  using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+  mrr::concurrent::sort(
+    pool, adaptive_partitioner(), first, last, std::less<value_type>()
+  );
+}
+
+template <typename Iterator, typename Compare>
+void sort(thread_pool& pool, Iterator first, Iterator last, Compare const& comp)
+{
+  mrr::concurrent::sort(pool, adaptive_partitioner(), first, last, comp);
+}
+
+template <typename Iterator1, typename Iterator2, typename OutputIterator>
+OutputIterator merge(
+  thread_pool& pool,
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first
+)
+{
+  using value_type = typename std::iterator_traits<Iterator1>::value_type;
+
+  return mrr::concurrent::merge(
+    pool, adaptive_partitioner(),
+    first1, last1, first2, last2, d_first,
+    std::less<value_type>()
+  );
+}
+
+template <
+  typename Iterator1, typename Iterator2,
+  typename OutputIterator, typename Compare
+>
+OutputIterator merge(
+  thread_pool& pool,
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first, Compare const& comp
+)
+{
+  return mrr::concurrent::merge(
+    pool, adaptive_partitioner(),
+    first1, last1, first2, last2, d_first, comp
+  );
+}
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Calling functions - explicit pool and partitioner versions
+template <typename Partitioner, typename Iterator, typename T>
+T accumulate(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, T init
+)
+{
+  if(first == last)
+    return init;
+
+  return accumulate_dispatch(
+    accumulate_blocks<Iterator,T>(), first, last, init, pool, partitioner
+  );
+}
+
+template <typename Partitioner, typename Iterator, typename T>
+auto count(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, T const& value
+)
+  -> typename std::iterator_traits<Iterator>::difference_type
+{
+  return in_parallel<parallel_count_impl<Iterator,T> >(pool,partitioner,first,last,value);
+}
+
+template <typename Partitioner, typename Iterator, typename Pred>
+auto count_if(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Pred const& pred
+)
+  -> typename std::iterator_traits<Iterator>::difference_type
+{
+  return in_parallel<parallel_count_if_impl<Iterator,Pred> >(pool,partitioner,first,last,pred);
+}
+
+template <typename Partitioner, typename Iterator, typename T>
+void fill(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, T const& value
+)
+{
+  in_parallel<parallel_fill_impl<Iterator,T> >(pool,partitioner,first,last,value);
+}
+
+template <typename Partitioner, typename Iterator, typename Func>
+void for_each(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Func const& func
+)
+{
+  in_parallel<parallel_for_each_impl<Iterator,Func> >(pool,partitioner,first,last,func);
+}
+
+template <typename Partitioner, typename Iterator>
+Iterator max_element(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last
+)
+{
+  return in_parallel<parallel_max_element_impl<Iterator> >(pool,partitioner,first,last);
+}
+
+template <typename Partitioner, typename Iterator>
+Iterator min_element(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last
+)
+{
+  return in_parallel<parallel_min_element_impl<Iterator> >(pool,partitioner,first,last);
+}
+
+template <typename Partitioner, typename Iterator, typename T>
+void replace(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, T const& old_val, T const& new_val
+)
+{
+  in_parallel<parallel_replace_impl<Iterator,T> >(pool,partitioner,first,last,old_val,new_val);
+}
+
+template <typename Partitioner, typename Iterator, typename Pred, typename T>
+void replace_if(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Pred const& pred, T const& new_val
+)
+{
+  in_parallel<parallel_replace_if_impl<Iterator,Pred,T> >(pool,partitioner,first,last,pred,new_val);
+}
+
+
+template <
+  typename Partitioner, typename Iterator,
+  typename T, typename BinaryOp, typename UnaryOp
+>
+auto transform_reduce(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last,
+  T init, BinaryOp const& reduce, UnaryOp const& transform
+)
+  -> typename std::enable_if<is_partitioner<Partitioner>::value, T>::type
+{
+  if(first == last)
+    return init;
+
+  return in_parallel<parallel_transform_reduce_impl<Iterator,T,BinaryOp,UnaryOp> >(
+    pool,partitioner,first,last,init,reduce,transform
+  );
+}
+
+// Only the general forms take a partitioner, so the operation is always
+// explicit here.
+template <
+  typename Partitioner, typename Iterator,
+  typename OutputIterator, typename BinaryOp
+>
+auto inclusive_scan(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, OutputIterator d_first, BinaryOp const& op
+)
+  -> typename std::enable_if<
+       is_partitioner<Partitioner>::value, OutputIterator
+     >::type
+{
+  return in_parallel_scan<parallel_inclusive_scan_impl<Iterator,OutputIterator,BinaryOp> >(
+    pool,partitioner,first,last,d_first,op
+  );
+}
+
+template <
+  typename Partitioner, typename Iterator,
+  typename OutputIterator, typename T, typename BinaryOp
+>
+auto exclusive_scan(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, OutputIterator d_first, T init, BinaryOp const& op
+)
+  -> typename std::enable_if<
+       is_partitioner<Partitioner>::value, OutputIterator
+     >::type
+{
+  return in_parallel_scan<parallel_exclusive_scan_impl<Iterator,OutputIterator,T,BinaryOp> >(
+    pool,partitioner,first,last,d_first,init,op
+  );
+}
+
+// The output must be a forward iterator: each block seeks to where its
+// selected elements go.
+template <
+  typename Partitioner, typename Iterator,
+  typename OutputIterator, typename Pred
+>
+auto copy_if(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, OutputIterator d_first, Pred const& pred
+)
+  -> typename std::enable_if<
+       is_partitioner<Partitioner>::value, OutputIterator
+     >::type
+{
+  return in_parallel_scan<parallel_copy_if_impl<Iterator,OutputIterator,Pred> >(
+    pool,partitioner,first,last,d_first,pred
+  );
+}
+
+// Stable: the relative order within each side is preserved. The
+// elements are moved out to a buffer, counted per block, and moved back
+// to their final positions; pred is called twice per element.
+template <typename Partitioner, typename Iterator, typename Pred>
+auto partition(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Pred const& pred
+)
+  -> typename std::enable_if<is_partitioner<Partitioner>::value, Iterator>::type
+{
+  using difference_type = typename std::iterator_traits<Iterator>::difference_type;
+  using value_type = typename std::iterator_traits<Iterator>::value_type;
+  using buffer_iterator = typename std::vector<value_type>::iterator;
+
+  const difference_type length = std::distance(first,last);
+
+  if(static_cast<std::size_t>(length) <= partitioner.sequential_cutoff())
+    return std::stable_partition(first,last,pred);
+
+  const std::size_t num_blocks =
+    partitioner.num_blocks(static_cast<std::size_t>(length), pool.size() + 1);
+
+  std::vector<value_type> buffer(
+    std::make_move_iterator(first), std::make_move_iterator(last)
+  );
+  padded_slots<difference_type> trues_before(num_blocks);
+
+  run_blocks(
+    pool, buffer.begin(), buffer.end(), length, num_blocks,
+    [&](std::size_t i, buffer_iterator block_first, buffer_iterator block_last) {
+      trues_before.set(i, std::count_if(block_first, block_last, pred));
+    }
+  );
+
+  difference_type num_trues = 0;
+  for(std::size_t i = 0; i != num_blocks; ++i)
+  {
+    difference_type const block_trues = trues_before[i];
+    trues_before[i] = num_trues;
+    num_trues += block_trues;
+  }
+
+  run_blocks(
+    pool, buffer.begin(), buffer.end(), length, num_blocks,
+    [&](std::size_t i, buffer_iterator block_first, buffer_iterator block_last) {
+      difference_type const falses_before =
+        block_offset(length, i, num_blocks) - trues_before[i];
+
+      Iterator d_true = std::next(first, trues_before[i]);
+      Iterator d_false = std::next(first, num_trues + falses_before);
+
+      for(; block_first != block_last; ++block_first)
+        if(pred(*block_first))
+          *d_true++ = std::move(*block_first);
+        else
+          *d_false++ = std::move(*block_first);
+    }
+  );
+
+  return std::next(first, num_trues);
+}
+
+// Sorts blocks of a moved-out copy of the range, then merges them
+// pairwise in rounds with the parallel merge, alternating between the
+// copy and the range. Requires random access iterators; not stable.
+template <typename Partitioner, typename Iterator, typename Compare>
+auto sort(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator first, Iterator last, Compare const& comp
+)
+  -> typename std::enable_if<is_partitioner<Partitioner>::value, void>::type
+{
+  using value_type = typename std::iterator_traits<Iterator>::value_type;
+  using buffer_iterator = typename std::vector<value_type>::iterator;
+
+  const std::ptrdiff_t length = last - first;
+
+  if(static_cast<std::size_t>(length) <= partitioner.sequential_cutoff())
+    return std::sort(first,last,comp);
+
+  const std::size_t num_blocks =
+    partitioner.num_blocks(static_cast<std::size_t>(length), pool.size() + 1);
+  const std::ptrdiff_t grain = std::max<std::ptrdiff_t>(2, length/num_blocks);
+
+  std::vector<value_type> buffer(
+    std::make_move_iterator(first), std::make_move_iterator(last)
+  );
+
+  run_blocks(
+    pool, buffer.begin(), buffer.end(), length, num_blocks,
+    [&](std::size_t, buffer_iterator block_first, buffer_iterator block_last) {
+      std::sort(block_first, block_last, comp);
+    }
+  );
+
+  std::vector<std::ptrdiff_t> bounds(num_blocks + 1);
+  for(std::size_t i = 0; i <= num_blocks; ++i)
+    bounds[i] = block_offset(length, i, num_blocks);
+
+  bool in_buffer = true;
+  while(bounds.size() > 2)
+  {
+    bounds = in_buffer
+      ? merge_round(pool, buffer.begin(), first, bounds, comp, grain)
+      : merge_round(pool, first, buffer.begin(), bounds, comp, grain);
+    in_buffer = !in_buffer;
+  }
+
+  if(in_buffer)
+    run_blocks(
+      pool, buffer.begin(), buffer.end(), length, num_blocks,
+      [&](std::size_t i, buffer_iterator block_first, buffer_iterator block_last) {
+        std::move(block_first, block_last, first + block_offset(length, i, num_blocks));
+      }
+    );
+}
+
+// Requires random access iterators.
+template <
+  typename Partitioner, typename Iterator1, typename Iterator2,
+  typename OutputIterator, typename Compare
+>
+auto merge(
+  thread_pool& pool, Partitioner const& partitioner,
+  Iterator1 first1, Iterator1 last1,
+  Iterator2 first2, Iterator2 last2,
+  OutputIterator d_first, Compare const& comp
+)
+  -> typename std::enable_if<
+       is_partitioner<Partitioner>::value, OutputIterator
+     >::type
+{
+  const std::ptrdiff_t length = (last1 - first1) + (last2 - first2);
+
+  if(static_cast<std::size_t>(length) <= partitioner.sequential_cutoff())
+    return std::merge(first1,last1,first2,last2,d_first,comp);
+
+  const std::size_t num_blocks =
+    partitioner.num_blocks(static_cast<std::size_t>(length), pool.size() + 1);
+
+  task_group tasks(pool);
+  merge_blocks(
+    tasks, first1, last1, first2, last2, d_first, comp,
+    std::max<std::ptrdiff_t>(2, length/num_blocks)
+  );
+  tasks.wait();
+
+  return d_first + length;
+}
+
+
 //m----------------------------------------------------------------------
 } // namespace concurrent
 //-----------------------------------------------------------------------
@@ -0,0 +1,172 @@
+// Thread scaling of the concurrent scan, transform_reduce, copy_if,
+// partition, sort and merge. Each is timed with the <algorithm>
+// equivalent as "threads=1" and then on pools of 1..N workers (N is the
+// hardware concurrency, or the second argument), the calling thread
+// helping as one more thread. Results are written as CSV.
+//
+//   algorithm_bench [elements] [max_threads]
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../algorithm.hxx"
+#include "../benchmark.hxx"
+
+namespace {
+
+using mrr::concurrent::thread_pool;
+
+
+bool is_odd(int x)
+{
+  return x % 2 != 0;
+}
+
+
+std::string label(char const* name, unsigned threads)
+{
+  return std::string(name) + "/threads=" + std::to_string(threads);
+}
+
+
+// Time the sequential version once and the parallel one for every pool
+// size. seq() and par(pool) do the same work.
+template <typename Seq, typename Par>
+void run_scaling(
+  mrr::benchmark_runner<>& runner, char const* name, unsigned max_threads,
+  Seq seq, Par par
+)
+{
+  runner.run(label(name, 1), seq);
+
+  for (unsigned threads = 2; threads <= max_threads + 1; ++threads)
+  {
+    thread_pool pool(threads - 1);
+    runner.run(label(name, threads), [&]() { par(pool); });
+  }
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+  std::size_t const n = argc > 1
+    ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10))
+    : std::size_t(1) << 22;
+  unsigned const max_threads = argc > 2
+    ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10))
+    : std::max(1u, std::thread::hardware_concurrency());
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(-1000000, 1000000);
+
+  std::vector<int> input(n);
+  for (int& x : input)
+    x = dist(gen);
+
+  std::vector<int> sorted_a(input.begin(), input.begin() + n/2);
+  std::vector<int> sorted_b(input.begin() + n/2, input.end());
+  std::sort(sorted_a.begin(), sorted_a.end());
+  std::sort(sorted_b.begin(), sorted_b.end());
+
+  std::vector<long long> sums(n);
+  std::vector<int> out(n);
+  std::vector<int> work(n);
+
+  mrr::benchmark_options options;
+  options.num_samples = 10;
+  mrr::benchmark_runner<> runner(options);
+
+  auto const square = [](int x) { return static_cast<long long>(x) * x; };
+
+  run_scaling(runner, "inclusive_scan", max_threads,
+    [&]() {
+      std::partial_sum(input.begin(), input.end(), sums.begin(), std::plus<long long>());
+      mrr::do_not_optimize(sums.back());
+    },
+    [&](thread_pool& pool) {
+      mrr::concurrent::inclusive_scan(
+        pool, input.begin(), input.end(), sums.begin(), std::plus<long long>()
+      );
+      mrr::do_not_optimize(sums.back());
+    }
+  );
+
+  run_scaling(runner, "transform_reduce", max_threads,
+    [&]() {
+      long long sum = 0;
+      for (int x : input)
+        sum += square(x);
+      mrr::do_not_optimize(sum);
+    },
+    [&](thread_pool& pool) {
+      mrr::do_not_optimize(mrr::concurrent::transform_reduce(
+        pool, input.begin(), input.end(), 0LL, std::plus<long long>(), square
+      ));
+    }
+  );
+
+  run_scaling(runner, "copy_if", max_threads,
+    [&]() {
+      mrr::do_not_optimize(std::copy_if(input.begin(), input.end(), out.begin(), is_odd));
+    },
+    [&](thread_pool& pool) {
+      mrr::do_not_optimize(
+        mrr::concurrent::copy_if(pool, input.begin(), input.end(), out.begin(), is_odd)
+      );
+    }
+  );
+
+  // Partition and sort work in place, so both versions include copying
+  // the input into the working range first.
+  run_scaling(runner, "partition", max_threads,
+    [&]() {
+      std::copy(input.begin(), input.end(), work.begin());
+      mrr::do_not_optimize(std::stable_partition(work.begin(), work.end(), is_odd));
+    },
+    [&](thread_pool& pool) {
+      std::copy(input.begin(), input.end(), work.begin());
+      mrr::do_not_optimize(
+        mrr::concurrent::partition(pool, work.begin(), work.end(), is_odd)
+      );
+    }
+  );
+
+  run_scaling(runner, "sort", max_threads,
+    [&]() {
+      std::copy(input.begin(), input.end(), work.begin());
+      std::sort(work.begin(), work.end());
+      mrr::do_not_optimize(work.front());
+    },
+    [&](thread_pool& pool) {
+      std::copy(input.begin(), input.end(), work.begin());
+      mrr::concurrent::sort(pool, work.begin(), work.end());
+      mrr::do_not_optimize(work.front());
+    }
+  );
+
+  run_scaling(runner, "merge", max_threads,
+    [&]() {
+      mrr::do_not_optimize(std::merge(
+        sorted_a.begin(), sorted_a.end(), sorted_b.begin(), sorted_b.end(), out.begin()
+      ));
+    },
+    [&](thread_pool& pool) {
+      mrr::do_not_optimize(mrr::concurrent::merge(
+        pool, sorted_a.begin(), sorted_a.end(), sorted_b.begin(), sorted_b.end(),
+        out.begin()
+      ));
+    }
+  );
+
+  runner.write_csv(std::cout);
+}
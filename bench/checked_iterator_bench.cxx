@@ -0,0 +1,78 @@
+// Cost of the checked_iterator policies over a plain vector iterator.
+// Each sums a vector with a hand written loop, which the checks sit in,
+// and with std::accumulate; the checked_range is validated once per
+// call. debug_checked costs nothing here, as the benchmarks are built
+// with NDEBUG. Results are written as CSV.
+//
+//   checked_iterator_bench [elements]
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "../benchmark.hxx"
+#include "../checked_iterator.hxx"
+
+namespace {
+
+template <typename Iterator>
+long loop_sum(Iterator first, Iterator last)
+{
+  long sum = 0;
+  for (; first != last; ++first)
+    sum += *first;
+  return sum;
+}
+
+
+template <typename Policy>
+void run_policy(
+  mrr::benchmark_runner<>& runner, char const* name, std::vector<int>& v
+)
+{
+  runner.run(std::string(name) + "/loop", [&]() {
+    mrr::do_not_optimize(loop_sum(
+      mrr::make_checked<Policy>(v), mrr::make_checked<Policy>(v, v.end())
+    ));
+  });
+
+  runner.run(std::string(name) + "/accumulate", [&]() {
+    mrr::do_not_optimize(std::accumulate(
+      mrr::make_checked<Policy>(v), mrr::make_checked<Policy>(v, v.end()), 0L
+    ));
+  });
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+  std::size_t const n = argc > 1
+    ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10))
+    : std::size_t(1) << 16;
+
+  std::vector<int> v(n, 1);
+  mrr::benchmark_runner<> runner;
+
+  runner.run("unchecked/loop", [&]() {
+    mrr::do_not_optimize(loop_sum(v.begin(), v.end()));
+  });
+  runner.run("unchecked/accumulate", [&]() {
+    mrr::do_not_optimize(std::accumulate(v.begin(), v.end(), 0L));
+  });
+
+  run_policy<mrr::always_checked>(runner, "always_checked", v);
+  run_policy<mrr::debug_checked>(runner, "debug_checked", v);
+  run_policy<mrr::sampled_checked<64> >(runner, "sampled_checked<64>", v);
+
+  runner.run("checked_range/loop", [&]() {
+    auto const r = mrr::make_checked_range(v, v.begin(), v.end());
+    mrr::do_not_optimize(loop_sum(r.begin(), r.end()));
+  });
+
+  runner.write_csv(std::cout);
+}
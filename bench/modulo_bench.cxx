@@ -0,0 +1,78 @@
+// Element-wise modular add and multiply of two arrays, as a loop over
+// modulo's operators and with batch_add/batch_mul, for a modulus
+// handled by each reduction. Only the mask and 32-bit Montgomery
+// reductions have SIMD lanes; for the others the batch functions run
+// the same scalar loop. Results are written as CSV.
+//
+//   modulo_bench [elements]
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../benchmark.hxx"
+#include "../modulo.hxx"
+
+namespace {
+
+template <std::size_t N>
+void run_modulus(mrr::benchmark_runner<>& runner, char const* name, std::size_t n)
+{
+  using mod = mrr::modulo<N>;
+
+  std::mt19937_64 rng(1);
+  std::vector<mod> a, b;
+  for (std::size_t i = 0; i != n; ++i)
+  {
+    a.push_back(mod(rng()));
+    b.push_back(mod(rng()));
+  }
+  std::vector<mod> out(n);
+
+  // Once out has escaped, clobber() keeps every store to it.
+  mrr::do_not_optimize(out.data());
+
+  runner.run(std::string(name) + "/add/scalar", [&]() {
+    for (std::size_t i = 0; i != n; ++i)
+      out[i] = a[i] + b[i];
+    mrr::clobber();
+  });
+  runner.run(std::string(name) + "/add/batch", [&]() {
+    mrr::batch_add(a.data(), a.data() + n, b.data(), out.data());
+    mrr::clobber();
+  });
+
+  runner.run(std::string(name) + "/mul/scalar", [&]() {
+    for (std::size_t i = 0; i != n; ++i)
+      out[i] = a[i] * b[i];
+    mrr::clobber();
+  });
+  runner.run(std::string(name) + "/mul/batch", [&]() {
+    mrr::batch_mul(a.data(), a.data() + n, b.data(), out.data());
+    mrr::clobber();
+  });
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+  std::size_t const n = argc > 1
+    ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10))
+    : std::size_t(1) << 14;
+
+  mrr::benchmark_runner<> runner;
+
+  run_modulus<std::size_t(1) << 32>(runner, "mask/2^32", n);
+  run_modulus<998244353>(runner, "montgomery32/998244353", n);
+  run_modulus<18446744073709551557ull>(runner, "montgomery64/2^64-59", n);
+  run_modulus<1000000006>(runner, "barrett/1000000006", n);
+  run_modulus<(std::size_t(1) << 63) + 2>(runner, "wide_barrett/2^63+2", n);
+
+  runner.write_csv(std::cout);
+}
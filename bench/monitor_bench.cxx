@@ -0,0 +1,118 @@
+// Contention on the monitor variants. Each run starts the given number
+// of threads, each doing a fixed number of operations on one shared
+// monitor, some fraction of them reads, and times the whole batch. The
+// async_monitor waits on every future, so it is measured as a
+// synchronous call. Results are written as CSV.
+//
+//   monitor_bench [max_threads]
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../benchmark.hxx"
+#include "../monitor.hxx"
+
+namespace {
+
+struct point
+{
+  long x;
+  long y;
+};
+
+
+std::size_t const ops_per_thread = 20000;
+
+
+// Each op reads with probability read_percent/100, spread evenly rather
+// than randomly so every thread does the same mix.
+template <typename Read, typename Write>
+void run_threads(unsigned threads, unsigned read_percent, Read read, Write write)
+{
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t != threads; ++t)
+    workers.emplace_back([&]() {
+      long sink = 0;
+      for (std::size_t i = 0; i != ops_per_thread; ++i)
+        if (i % 100 < read_percent)
+          sink += read();
+        else
+          write();
+      mrr::do_not_optimize(sink);
+    });
+
+  for (std::thread& w : workers)
+    w.join();
+}
+
+
+std::string label(char const* name, unsigned read_percent, unsigned threads)
+{
+  return std::string(name) + "/reads=" + std::to_string(read_percent)
+    + "%/threads=" + std::to_string(threads);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+  unsigned const max_threads = argc > 1
+    ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10))
+    : std::max(2u, std::thread::hardware_concurrency());
+
+  mrr::benchmark_options options;
+  options.num_samples = 10;
+  mrr::benchmark_runner<> runner(options);
+
+  auto const bump = [](point& p) { ++p.x; ++p.y; };
+  auto const get_x = [](point const& p) { return p.x; };
+
+  unsigned const read_percents[] = { 100, 90, 50 };
+
+  for (unsigned reads : read_percents)
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+      mrr::monitor<point> m;
+      runner.run(label("monitor", reads, threads), [&]() {
+        run_threads(threads, reads,
+          [&]() { return m(get_x); },
+          [&]() { m(bump); });
+      });
+
+      mrr::shared_monitor<point> sm;
+      runner.run(label("shared_monitor", reads, threads), [&]() {
+        run_threads(threads, reads,
+          [&]() { return sm.read(get_x); },
+          [&]() { sm.write(bump); });
+      });
+
+      mrr::seqlock_monitor<point> seq;
+      runner.run(label("seqlock_monitor", reads, threads), [&]() {
+        run_threads(threads, reads,
+          [&]() { return seq(get_x); },
+          [&]() { seq.update(bump); });
+      });
+
+      mrr::rcu_monitor<point> rcu;
+      runner.run(label("rcu_monitor", reads, threads), [&]() {
+        run_threads(threads, reads,
+          [&]() { return rcu(get_x); },
+          [&]() { rcu.update(bump); });
+      });
+
+      mrr::async_monitor<point> async;
+      runner.run(label("async_monitor", reads, threads), [&]() {
+        run_threads(threads, reads,
+          [&]() { return async([](point& p) { return p.x; }).get(); },
+          [&]() { async(bump).get(); });
+      });
+    }
+
+  runner.write_csv(std::cout);
+}
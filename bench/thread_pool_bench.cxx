@@ -0,0 +1,83 @@
+// Overhead of running work on the persistent pool against spawning a
+// thread per piece of work, which is what in_parallel did before the
+// pool. Each batch runs one task per thread; the tasks are empty, or
+// sum a small slice of a vector, so the cost measured is the scheduling.
+// Results are written as CSV.
+//
+//   thread_pool_bench [threads]
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "../algorithm.hxx"
+#include "../benchmark.hxx"
+#include "../thread_pool.hxx"
+
+namespace {
+
+using mrr::concurrent::task_group;
+using mrr::concurrent::thread_pool;
+
+
+// Run work(i) for i in [0,n) with one std::thread each.
+template <typename Work>
+void spawn_threads(unsigned n, Work const& work)
+{
+  std::vector<std::thread> threads;
+  threads.reserve(n);
+  for (unsigned i = 0; i != n; ++i)
+    threads.emplace_back([&work, i]() { work(i); });
+  for (std::thread& t : threads)
+    t.join();
+}
+
+
+// Run work(i) for i in [0,n) as tasks on the pool.
+template <typename Work>
+void run_tasks(thread_pool& pool, unsigned n, Work const& work)
+{
+  task_group tasks(pool);
+  for (unsigned i = 0; i != n; ++i)
+    tasks.run([&work, i]() { work(i); });
+  tasks.wait();
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+  unsigned const threads = argc > 1
+    ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10))
+    : std::max(2u, std::thread::hardware_concurrency());
+
+  thread_pool pool(threads - 1);
+  mrr::benchmark_runner<> runner;
+
+  auto const empty = [](unsigned) {};
+  runner.run("empty/spawn", [&]() { spawn_threads(threads, empty); });
+  runner.run("empty/pool", [&]() { run_tasks(pool, threads, empty); });
+
+  std::vector<int> data(std::size_t(threads) * 4096, 1);
+  std::vector<long> sums(threads);
+  auto const sum_slice = [&](unsigned i) {
+    auto const first = data.begin() + std::ptrdiff_t(i) * 4096;
+    sums[i] = std::accumulate(first, first + 4096, 0L);
+  };
+  runner.run("sum_4k/spawn", [&]() { spawn_threads(threads, sum_slice); });
+  runner.run("sum_4k/pool", [&]() { run_tasks(pool, threads, sum_slice); });
+
+  // The whole in_parallel path: split, schedule, combine.
+  runner.run("accumulate/pool", [&]() {
+    mrr::do_not_optimize(
+      mrr::concurrent::accumulate(pool, data.begin(), data.end(), 0L)
+    );
+  });
+
+  runner.write_csv(std::cout);
+}
@@ -0,0 +1,96 @@
+// Splitting CSV text into fields with the tokenizer, from a buffer and
+// from a stream, against std::getline over a stringstream. The "5 delims"
+// runs use more delimiters than the vector scan takes, so they measure
+// the scalar table lookup. Each run counts the fields and adds up their
+// lengths. Results are written as CSV.
+//
+//   tokenizer_bench [rows]
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "../benchmark.hxx"
+#include "../tokenizer.hxx"
+
+namespace {
+
+// rows lines of 8 fields of 1 to 16 characters.
+std::string make_csv(std::size_t rows)
+{
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<std::size_t> length(1, 16);
+
+  std::string text;
+  for (std::size_t r = 0; r != rows; ++r)
+    for (std::size_t f = 0; f != 8; ++f)
+    {
+      text.append(length(rng), 'a' + static_cast<char>(f));
+      text.push_back(f == 7 ? '\n' : ',');
+    }
+  return text;
+}
+
+
+std::size_t tokenize(mrr::tokenizer& tok)
+{
+  std::size_t total = 0;
+  std::string_view field;
+  while (tok.next(field))
+    total += field.size() + 1;
+  return total;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+  std::size_t const rows = argc > 1
+    ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10))
+    : std::size_t(1) << 16;
+
+  std::string const text = make_csv(rows);
+  mrr::benchmark_runner<> runner;
+
+  runner.run("getline/stream", [&]() {
+    std::istringstream is(text);
+    std::string line, field;
+    std::size_t total = 0;
+    while (std::getline(is, line))
+    {
+      std::istringstream fields(line);
+      while (std::getline(fields, field, ','))
+        total += field.size() + 1;
+    }
+    mrr::do_not_optimize(total);
+  });
+
+  runner.run("tokenizer/buffer", [&]() {
+    mrr::tokenizer tok(text);
+    mrr::do_not_optimize(tokenize(tok));
+  });
+
+  runner.run("tokenizer/buffer/5 delims", [&]() {
+    mrr::tokenizer tok(text, ",;|\t ");
+    mrr::do_not_optimize(tokenize(tok));
+  });
+
+  runner.run("tokenizer/stream", [&]() {
+    std::istringstream is(text);
+    mrr::tokenizer tok(is);
+    mrr::do_not_optimize(tokenize(tok));
+  });
+
+  runner.run("tokenizer/stream/4KiB blocks", [&]() {
+    std::istringstream is(text);
+    mrr::tokenizer tok(is, ",", '\n', 4096);
+    mrr::do_not_optimize(tokenize(tok));
+  });
+
+  runner.write_csv(std::cout);
+}
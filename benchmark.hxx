@@ -0,0 +1,458 @@
+#ifndef MRR_CXX_UTILS_BENCHMARK_HXX_
+#define MRR_CXX_UTILS_BENCHMARK_HXX_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <ratio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  include <x86intrin.h>
+#  define MRR_HAS_TSC_CLOCK 1
+#endif
+
+#include "stopwatch.hxx"
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+namespace mrr {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Optimization barriers.
+
+// Make the compiler assume value is read, so the computation producing
+// it cannot be removed.
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+#if defined(__GNUC__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  char const volatile* p = reinterpret_cast<char const volatile*>(&value);
+  (void)*p;
+#endif
+}
+
+// Make the compiler assume all memory is read and written, so stores
+// before it cannot be removed or sunk past it.
+inline void clobber()
+{
+#if defined(__GNUC__)
+  asm volatile("" : : : "memory");
+#endif
+}
+
+
+
+#ifdef MRR_HAS_TSC_CLOCK
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Clock reading the CPU time stamp counter. The tick length is measured
+// against steady_clock on first use. Assumes an invariant TSC, which all
+// x86 CPUs of the last decade have. Usable as stopwatch<tsc_clock>.
+struct tsc_clock
+{
+  using rep = double;
+  using period = std::nano;
+  using duration = std::chrono::duration<rep, period>;
+  using time_point = std::chrono::time_point<tsc_clock>;
+
+  static bool const is_steady = true;
+
+  static time_point now()
+  {
+    return time_point(duration(static_cast<double>(__rdtsc()) * ns_per_tick()));
+  }
+
+  static double ns_per_tick()
+  {
+    static double const ratio = calibrate();
+    return ratio;
+  }
+
+private:
+  static double calibrate()
+  {
+    using std::chrono::steady_clock;
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+
+    steady_clock::time_point const start = steady_clock::now();
+    unsigned long long const start_ticks = __rdtsc();
+
+    steady_clock::time_point end;
+    do
+      end = steady_clock::now();
+    while (end - start < std::chrono::milliseconds(20));
+
+    unsigned long long const ticks = __rdtsc() - start_ticks;
+    return static_cast<double>(duration_cast<nanoseconds>(end - start).count())
+      / static_cast<double>(ticks);
+  }
+};
+
+#endif // #ifdef MRR_HAS_TSC_CLOCK
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Constant memory statistics.
+
+// Mean and variance by Welford's method. The mean is updated as in
+// online_average (algorithm.hxx), which is not included for just that.
+class running_stats
+{
+public:
+  running_stats()
+    : count_(0), mean_(0), m2_(0),
+      min_(std::numeric_limits<double>::infinity()),
+      max_(-std::numeric_limits<double>::infinity())
+  {
+  }
+
+  void push(double x)
+  {
+    ++count_;
+    double const previous_mean = mean_;
+    mean_ += (x - mean_) / static_cast<double>(count_);
+    m2_ += (x - previous_mean) * (x - mean_);
+    min_ = std::min(min_, x);
+    max_ = std::max(max_, x);
+  }
+
+  std::size_t count() const { return count_; }
+  double mean() const { return mean_; }
+  double min() const { return min_; }
+  double max() const { return max_; }
+
+  // Sample standard deviation.
+  double stddev() const
+  {
+    return count_ > 1 ? std::sqrt(m2_ / static_cast<double>(count_ - 1)) : 0.0;
+  }
+
+private:
+  std::size_t count_;
+  double mean_;
+  double m2_;
+  double min_;
+  double max_;
+};
+
+
+// Streaming estimate of the p-quantile with the P-squared algorithm
+// (Jain and Chlamtac, 1985): five markers track the minimum, p/2, p,
+// (1+p)/2 and maximum, and are moved along a parabola fitted through
+// their neighbours as observations arrive.
+class p2_quantile
+{
+public:
+  explicit p2_quantile(double p)
+    : p_(p), count_(0)
+  {
+    double const desired[5] = { 0, 2*p, 4*p, 2 + 2*p, 4 };
+    double const increment[5] = { 0, p/2, p, (1 + p)/2, 1 };
+
+    for (int i = 0; i != 5; ++i)
+    {
+      heights_[i] = 0;
+      positions_[i] = i;
+      desired_[i] = desired[i];
+      increment_[i] = increment[i];
+    }
+  }
+
+  void push(double x)
+  {
+    if (count_ < 5)
+    {
+      heights_[count_++] = x;
+      std::sort(heights_, heights_ + count_);
+      return;
+    }
+    ++count_;
+
+    int k;
+    if (x < heights_[0])
+    {
+      heights_[0] = x;
+      k = 0;
+    }
+    else if (x >= heights_[4])
+    {
+      heights_[4] = x;
+      k = 3;
+    }
+    else
+    {
+      k = 0;
+      while (x >= heights_[k + 1])
+        ++k;
+    }
+
+    for (int i = k + 1; i != 5; ++i)
+      ++positions_[i];
+    for (int i = 0; i != 5; ++i)
+      desired_[i] += increment_[i];
+
+    for (int i = 1; i != 4; ++i)
+    {
+      double const d = desired_[i] - positions_[i];
+
+      if ((d >= 1 && positions_[i+1] - positions_[i] > 1)
+          || (d <= -1 && positions_[i-1] - positions_[i] < -1))
+      {
+        int const step = d > 0 ? 1 : -1;
+        double const h = parabolic(i, step);
+
+        heights_[i] = (heights_[i-1] < h && h < heights_[i+1])
+          ? h
+          : linear(i, step);
+        positions_[i] += step;
+      }
+    }
+  }
+
+  double value() const
+  {
+    if (count_ == 0)
+      return 0;
+    if (count_ <= 5)
+      return heights_[static_cast<std::size_t>(std::lround(p_ * (count_ - 1)))];
+    return heights_[2];
+  }
+
+private:
+  double parabolic(int i, int d) const
+  {
+    double const n_prev = positions_[i-1];
+    double const n = positions_[i];
+    double const n_next = positions_[i+1];
+
+    return heights_[i] + d / (n_next - n_prev) * (
+      (n - n_prev + d) * (heights_[i+1] - heights_[i]) / (n_next - n)
+      + (n_next - n - d) * (heights_[i] - heights_[i-1]) / (n - n_prev)
+    );
+  }
+
+  double linear(int i, int d) const
+  {
+    return heights_[i]
+      + d * (heights_[i+d] - heights_[i]) / (positions_[i+d] - positions_[i]);
+  }
+
+  double p_;
+  std::size_t count_;
+  double heights_[5];
+  double positions_[5];
+  double desired_[5];
+  double increment_[5];
+};
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Benchmark runner.
+
+struct benchmark_options
+{
+  // Time spent running the function before measuring.
+  double warmup_seconds = 0.1;
+
+  // Each sample runs the function enough times to take at least this
+  // long, so clock resolution and overhead are negligible.
+  double min_sample_seconds = 0.01;
+
+  std::size_t num_samples = 30;
+};
+
+
+// All times are nanoseconds per call.
+struct benchmark_result
+{
+  std::string name;
+  std::size_t iterations;
+  std::size_t samples;
+  double mean;
+  double stddev;
+  double min;
+  double max;
+  double p50;
+  double p90;
+  double p99;
+};
+
+
+template <typename ClockType = std::chrono::high_resolution_clock>
+class benchmark_runner
+{
+public:
+  explicit benchmark_runner(benchmark_options const& options = benchmark_options())
+    : options_(options)
+  {
+  }
+
+  // Time f(), which takes no arguments. Use do_not_optimize on its
+  // results so the work is not optimized away. The result is returned
+  // by value; it is also kept in results().
+  template <typename Func>
+  benchmark_result run(std::string name, Func&& f)
+  {
+    warmup(f);
+    std::size_t const iterations = calibrate(f);
+
+    running_stats stats;
+    p2_quantile p50(0.5), p90(0.9), p99(0.99);
+
+    for (std::size_t s = 0; s != options_.num_samples; ++s)
+    {
+      double const ns = time_batch(f, iterations) * 1e9 / iterations;
+      stats.push(ns);
+      p50.push(ns);
+      p90.push(ns);
+      p99.push(ns);
+    }
+
+    benchmark_result result;
+    result.name = std::move(name);
+    result.iterations = iterations;
+    result.samples = stats.count();
+    result.mean = stats.mean();
+    result.stddev = stats.stddev();
+    result.min = stats.min();
+    result.max = stats.max();
+    result.p50 = p50.value();
+    result.p90 = p90.value();
+    result.p99 = p99.value();
+
+    results_.push_back(result);
+    return result;
+  }
+
+  std::vector<benchmark_result> const& results() const
+  {
+    return results_;
+  }
+
+  template <typename Char, typename Traits>
+  void write_csv(std::basic_ostream<Char,Traits>& os) const
+  {
+    os << "name,iterations,samples,mean_ns,stddev_ns,min_ns,max_ns,"
+          "p50_ns,p90_ns,p99_ns\n";
+
+    for (benchmark_result const& r : results_)
+    {
+      os << '"';
+      for (char c : r.name)
+        os << (c == '"' ? "\"\"" : std::string(1, c));
+      os << "\"," << r.iterations << ',' << r.samples
+         << ',' << r.mean << ',' << r.stddev
+         << ',' << r.min << ',' << r.max
+         << ',' << r.p50 << ',' << r.p90 << ',' << r.p99 << '\n';
+    }
+  }
+
+  template <typename Char, typename Traits>
+  void write_json(std::basic_ostream<Char,Traits>& os) const
+  {
+    os << "[\n";
+    for (std::size_t i = 0; i != results_.size(); ++i)
+    {
+      benchmark_result const& r = results_[i];
+
+      os << "  {\"name\": \"";
+      for (char c : r.name)
+      {
+        if (c == '"' || c == '\\')
+          os << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+          os << ' ';
+        else
+          os << c;
+      }
+      os << "\", \"iterations\": " << r.iterations
+         << ", \"samples\": " << r.samples
+         << ", \"mean_ns\": " << r.mean
+         << ", \"stddev_ns\": " << r.stddev
+         << ", \"min_ns\": " << r.min
+         << ", \"max_ns\": " << r.max
+         << ", \"p50_ns\": " << r.p50
+         << ", \"p90_ns\": " << r.p90
+         << ", \"p99_ns\": " << r.p99
+         << '}' << (i + 1 != results_.size() ? ",\n" : "\n");
+    }
+    os << "]\n";
+  }
+
+private:
+  // Seconds to call f() the given number of times.
+  template <typename Func>
+  double time_batch(Func& f, std::size_t iterations)
+  {
+    stopwatch<ClockType> sw;
+    for (std::size_t i = 0; i != iterations; ++i)
+    {
+      f();
+      clobber();
+    }
+    return sw.lap();
+  }
+
+  template <typename Func>
+  void warmup(Func& f)
+  {
+    stopwatch<ClockType> sw;
+    double elapsed = 0;
+    do
+    {
+      f();
+      clobber();
+      elapsed += sw.lap();
+    }
+    while (elapsed < options_.warmup_seconds);
+  }
+
+  // Grow the number of calls per sample until a sample takes at least
+  // min_sample_seconds.
+  template <typename Func>
+  std::size_t calibrate(Func& f)
+  {
+    std::size_t iterations = 1;
+    for (;;)
+    {
+      double const seconds = time_batch(f, iterations);
+      if (seconds >= options_.min_sample_seconds)
+        return iterations;
+
+      double const scale = seconds > 0
+        ? 1.2 * options_.min_sample_seconds / seconds
+        : 10.0;
+      iterations = static_cast<std::size_t>(
+        iterations * std::min(10.0, std::max(2.0, scale))
+      );
+    }
+  }
+
+  benchmark_options options_;
+  std::vector<benchmark_result> results_;
+};
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+} // namespace mrr
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+#endif // MRR_CXX_UTILS_BENCHMARK_HXX_
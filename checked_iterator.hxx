@@ -2,7 +2,13 @@
 #define MRR_CXX_UTILS_CHECKED_ITERATOR_HXX_
 
 #include <iterator>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "simd.hxx"
 
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
@@ -11,11 +17,86 @@ namespace mrr {
 //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
 
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Checking policies.
+//
+// A policy decides when checked_iterator checks. It provides
+//
+//   static bool const validate;
+//     Whether the constructor checks that the iterator belongs to the
+//     container.
+//
+//   bool check() const;
+//     Called before every checked operation; the bounds are only looked
+//     at when it returns true. When it is a constant false the compiler
+//     removes the checks, and the loop is as fast as with Iter itself.
+
+// Check every operation. The default.
+struct always_checked
+{
+  static bool const validate = true;
+
+  bool check() const
+  {
+    return true;
+  }
+};
+
+
+// Check every operation unless NDEBUG is defined.
+struct debug_checked
+{
+#ifdef NDEBUG
+  static bool const validate = false;
+
+  bool check() const
+  {
+    return false;
+  }
+#else
+  static bool const validate = true;
+
+  bool check() const
+  {
+    return true;
+  }
+#endif
+};
+
+
+// Check one operation in every Period, starting with the first.
+template <unsigned Period = 64>
+class sampled_checked
+{
+public:
+  static_assert(Period != 0, "Period must be positive");
+
+  static bool const validate = true;
+
+  bool check() const
+  {
+    if (--countdown_ != 0)
+      return false;
+
+    countdown_ = Period;
+    return true;
+  }
+
+private:
+  mutable unsigned countdown_ = 1;
+};
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
 template <
   typename Cont,
-  typename Iter = typename Cont::iterator
+  typename Iter = typename Cont::iterator,
+  typename Policy = always_checked
 >
-class checked_iterator : public std::iterator_traits<Iter>
+class checked_iterator
+  : public std::iterator_traits<Iter>, private Policy
 {
   using traits_type = std::iterator_traits<Iter>;
 
@@ -24,9 +105,25 @@ public:
   using value_type = typename traits_type::value_type;
   using pointer = typename traits_type::pointer;
   using reference = typename traits_type::reference;
-  using iterator_categor = typename traits_type::iterator_category;
+  using iterator_category = typename traits_type::iterator_category;
+  using policy_type = Policy;
+
+#if __cplusplus > 201703L
+  // Lets std::to_address and the C++20 contiguous algorithms see through
+  // the wrapper when Iter is contiguous.
+  using iterator_concept = typename std::conditional<
+    std::contiguous_iterator<Iter>,
+    std::contiguous_iterator_tag,
+    iterator_category
+  >::type;
+  using element_type = typename std::remove_reference<reference>::type;
+#endif
+
+  checked_iterator()
+    : cont_(nullptr), current_()
+  {
+  }
 
-  checked_iterator() = delete;
   checked_iterator(checked_iterator const& ) = default;
   checked_iterator(checked_iterator&& ) = default;
   checked_iterator& operator =(checked_iterator const& ) = default;
@@ -36,36 +133,41 @@ public:
   checked_iterator(Cont& c, Iter p)
     : cont_(&c), current_(std::move(p))
   {
-    valid(current_);
+    if (Policy::validate)
+      valid(current_);
   }
 
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
   // Dereference and access operators.
-  reference operator *()
+  reference operator *() const
   {
     using std::end;
 
-    if (current_ == end(*cont_))
+    if (this->check() && current_ == end(*cont_))
       throw std::out_of_range("Attempt to dereference end detected");
     return *current_;
   }
 
-  pointer operator ->()
+  // Not checked, like std::to_address: a contiguous iterator's end has an
+  // address too, e.g. for std::span(first, last) over an empty range.
+  pointer operator ->() const
   {
-    return &*current_;
+    return address_of(current_, 0);
   }
 
-  reference operator [](difference_type d)
+  reference operator [](difference_type d) const
   {
+    using std::begin;
     using std::end;
 
-    if (end(*cont_) - current_ <= d)
+    if (this->check()
+        && (end(*cont_) - current_ <= d || current_ - begin(*cont_) < -d))
       throw std::out_of_range(
         "Attempt to access element [" + std::to_string(d) + "] detected"
       );
 
-    return cont_[d];
+    return current_[d];
   }
 
 
@@ -76,7 +178,7 @@ public:
   {
     using std::end;
 
-    if (current_ == end(*cont_))
+    if (this->check() && current_ == end(*cont_))
       throw std::out_of_range("Attempt to incement past end detected");
 
     ++current_;
@@ -94,7 +196,7 @@ public:
   {
     using std::begin;
 
-    if (current_ == begin(*cont_))
+    if (this->check() && current_ == begin(*cont_))
       throw std::out_of_range("Attempt to decrement before begin detected");
 
     --current_;
@@ -113,9 +215,11 @@ public:
   // Addition assignment and subtraction assignment operators.
   checked_iterator& operator +=(difference_type d)
   {
+    using std::begin;
     using std::end;
 
-    if (end(*cont_) - current_ < d)
+    if (this->check()
+        && (end(*cont_) - current_ < d || current_ - begin(*cont_) < -d))
       throw std::out_of_range(
         "Attempt to move past end with += " + std::to_string(d) + " detected"
       );
@@ -127,8 +231,10 @@ public:
   checked_iterator& operator -=(difference_type d)
   {
     using std::begin;
+    using std::end;
 
-    if (current - begin(*cont_) < d)
+    if (this->check()
+        && (current_ - begin(*cont_) < d || end(*cont_) - current_ < -d))
       throw std::out_of_range(
         "Attempt to move before begin with -= "
         + std::to_string(d) + " detected"
@@ -139,34 +245,45 @@ public:
   }
 
 
+  //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+  // Distance between iterators into the same container.
+  difference_type operator -(checked_iterator const& rhs) const
+  {
+    if (this->check() && cont_ != rhs.cont_)
+      throw std::out_of_range("Distance between different containers");
+
+    return current_ - rhs.current_;
+  }
+
+
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
   // Comparison operators.
-  bool operator ==(checked_iterator const& rhs)
+  bool operator ==(checked_iterator const& rhs) const
   {
     return cont_ == rhs.cont_ && current_ == rhs.current_;
   }
 
-  bool operator !=(checked_iterator const& rhs)
+  bool operator !=(checked_iterator const& rhs) const
   {
     return !(*this == rhs);
   }
 
-  bool operator <(checked_iterator const& rhs)
+  bool operator <(checked_iterator const& rhs) const
   {
     return cont_ == rhs.cont_ && current_ < rhs.current_;
   }
 
-  bool operator >(checked_iterator const& rhs)
+  bool operator >(checked_iterator const& rhs) const
   {
     return rhs < *this;
   }
 
-  bool operator <=(checked_iterator const& rhs)
+  bool operator <=(checked_iterator const& rhs) const
   {
     return *this < rhs || *this == rhs;
   }
 
-  bool operator >=(checked_iterator const& rhs)
+  bool operator >=(checked_iterator const& rhs) const
   {
     return rhs <= *this;
   }
@@ -190,11 +307,33 @@ private:
   Cont* cont_;
   Iter current_;
 
+  //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+  // The address an iterator refers to, without dereferencing it where
+  // the iterator can say so itself.
+  template <typename T>
+  static T* address_of(T* p, int)
+  {
+    return p;
+  }
+
+  template <typename I>
+  static auto address_of(I const& i, int)
+    -> decltype(i.operator ->())
+  {
+    return i.operator ->();
+  }
+
+  template <typename I>
+  static pointer address_of(I const& i, long)
+  {
+    return std::addressof(*i);
+  }
+
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
   // Check the validity of the iterator passed in w.r.t. the container.
   void valid(Iter p)
   {
-    if (valid_helper(p, typename traits_type::iterator_category()))
+    if (valid_helper(p, iterator_category()))
       return;
     else
       throw std::out_of_range("Invalid iterator provided to constructor");
@@ -228,45 +367,79 @@ private:
 
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 // Addition and subtraction operators.
-template <typename Cont, typename Iter>
-inline checked_iterator<Cont,Iter> operator +(
-  checked_iterator<Cont,Iter> iter,
-  typename checked_iterator<Cont,Iter>::different_type d
+template <typename Cont, typename Iter, typename Policy>
+inline checked_iterator<Cont,Iter,Policy> operator +(
+  checked_iterator<Cont,Iter,Policy> iter,
+  typename checked_iterator<Cont,Iter,Policy>::difference_type d
 )
 {
   iter += d;
   return iter;
 }
 
-template <typename Cont, typename Iter>
-inline checked_iterator<Cont,Iter> operator +(
-  typename checked_iterator<Cont,Iter>::different_type d,
-  checked_iterator<Cont,Iter> iter
+template <typename Cont, typename Iter, typename Policy>
+inline checked_iterator<Cont,Iter,Policy> operator +(
+  typename checked_iterator<Cont,Iter,Policy>::difference_type d,
+  checked_iterator<Cont,Iter,Policy> iter
 )
 {
   iter += d;
   return iter;
 }
 
-template <typename Cont, typename Iter>
-inline checked_iterator<Cont,Iter> operator -(
-  checked_iterator<Cont,Iter> iter,
-  typename checked_iterator<Cont,Iter>::different_type d
+template <typename Cont, typename Iter, typename Policy>
+inline checked_iterator<Cont,Iter,Policy> operator -(
+  checked_iterator<Cont,Iter,Policy> iter,
+  typename checked_iterator<Cont,Iter,Policy>::difference_type d
 )
 {
   iter -= d;
   return iter;
 }
 
-template <typename Cont, typename Iter>
-inline checked_iterator<Cont,Iter> operator -(
-  typename checked_iterator<Cont,Iter>::different_type d,
-  checked_iterator<Cont,Iter> iter
-)
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// A range of a container checked once, when it is made, and then
+// iterated with the container's own iterators. std::copy, memcpy and
+// the SIMD paths all see the raw iterators, so loops over it cost
+// exactly what loops over [first,last) cost.
+template <typename Iter>
+class checked_range
 {
-  iter -= d;
-  return iter;
-}
+public:
+  using iterator = Iter;
+  using difference_type = typename std::iterator_traits<Iter>::difference_type;
+
+  checked_range(Iter first, Iter last)
+    : first_(std::move(first)), last_(std::move(last))
+  {
+  }
+
+  Iter begin() const
+  {
+    return first_;
+  }
+
+  Iter end() const
+  {
+    return last_;
+  }
+
+  difference_type size() const
+  {
+    return std::distance(first_, last_);
+  }
+
+  bool empty() const
+  {
+    return first_ == last_;
+  }
+
+private:
+  Iter first_;
+  Iter last_;
+};
 
 
 
@@ -289,6 +462,92 @@ checked_iterator<Cont, typename Cont::iterator> make_checked(Cont& c)
 }
 
 
+template <typename Policy, typename Cont, typename Iter>
+checked_iterator<Cont, Iter, Policy> make_checked(Cont& c, Iter i)
+{
+  return checked_iterator<Cont,Iter,Policy>(c, i);
+}
+
+
+template <typename Policy, typename Cont>
+checked_iterator<Cont, typename Cont::iterator, Policy> make_checked(Cont& c)
+{
+  using std::begin;
+
+  return checked_iterator<Cont,typename Cont::iterator,Policy>(c, begin(c));
+}
+
+
+namespace detail {
+
+template <typename Cont, typename Iter>
+bool valid_range(Cont& c, Iter first, Iter last, std::input_iterator_tag)
+{
+  using std::begin;
+  using std::end;
+
+  Iter i = begin(c);
+  for (; i != first; ++i)
+    if (i == end(c))
+      return false;
+
+  for (; i != last; ++i)
+    if (i == end(c))
+      return false;
+
+  return true;
+}
+
+template <typename Cont, typename Iter>
+bool valid_range(Cont& c, Iter first, Iter last, std::random_access_iterator_tag)
+{
+  using std::begin;
+  using std::end;
+
+  return begin(c) <= first && first <= last && last <= end(c);
+}
+
+} // namespace detail
+
+
+// Check [first,last) is a range of c once, then iterate it raw.
+template <typename Cont, typename Iter>
+checked_range<Iter> make_checked_range(Cont& c, Iter first, Iter last)
+{
+  if (!detail::valid_range(
+        c, first, last,
+        typename std::iterator_traits<Iter>::iterator_category()))
+    throw std::out_of_range("Invalid range provided to make_checked_range");
+
+  return checked_range<Iter>(first, last);
+}
+
+
+template <typename Cont>
+checked_range<typename Cont::iterator> make_checked_range(Cont& c)
+{
+  using std::begin;
+  using std::end;
+
+  return checked_range<typename Cont::iterator>(begin(c), end(c));
+}
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// A checked_iterator over contiguous storage is contiguous too, so the
+// SIMD paths of the concurrent algorithms still apply to it.
+
+namespace simd {
+
+template <typename Cont, typename Iter, typename Policy, typename Value>
+struct is_contiguous_iterator<checked_iterator<Cont,Iter,Policy>, Value>
+  : is_contiguous_iterator<Iter>
+{
+};
+
+} // namespace simd
+
+
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
 } // namespace mrr
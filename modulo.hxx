@@ -1,16 +1,436 @@
 #ifndef MRR_MODULO_HXX_
 #define MRR_MODULO_HXX_
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "simd.hxx"
+
+// The arithmetic is constexpr from C++14, which allows the loops and
+// local variables it needs.
+#if __cplusplus >= 201402L
+#  define MRR_MODULO_CONSTEXPR constexpr
+#else
+#  define MRR_MODULO_CONSTEXPR inline
+#endif
+
+// The lane operations are only ever inlined into the batch kernels.
+#ifdef MRR_SIMD_ENABLED
+#  define MRR_MODULO_LANES MRR_SIMD_INLINE
+#else
+#  define MRR_MODULO_LANES inline
+#endif
+
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
 namespace mrr {
 
 //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
+
+namespace detail {
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// 64-bit helpers.
+
+struct uint128
+{
+  std::uint64_t hi;
+  std::uint64_t lo;
+};
+
+
+// Full 128-bit product of a and b.
+MRR_MODULO_CONSTEXPR uint128 mul_wide(std::uint64_t a, std::uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef unsigned __int128 wide_type;
+  wide_type const p = static_cast<wide_type>(a) * b;
+  return uint128{ static_cast<std::uint64_t>(p >> 64), static_cast<std::uint64_t>(p) };
+#else
+  std::uint64_t const mask = 0xffffffffu;
+  std::uint64_t const ll = (a & mask) * (b & mask);
+  std::uint64_t const lh = (a & mask) * (b >> 32);
+  std::uint64_t const hl = (a >> 32) * (b & mask);
+  std::uint64_t const hh = (a >> 32) * (b >> 32);
+  std::uint64_t const mid = (ll >> 32) + (lh & mask) + (hl & mask);
+  return uint128{
+    hh + (lh >> 32) + (hl >> 32) + (mid >> 32),
+    (mid << 32) | (ll & mask)
+  };
+#endif
+}
+
+
+// a + b and a - b modulo n for a, b < n, without overflowing.
+MRR_MODULO_CONSTEXPR std::uint64_t add_mod(std::uint64_t a, std::uint64_t b, std::uint64_t n)
+{
+  return a >= n - b ? a - (n - b) : a + b;
+}
+
+MRR_MODULO_CONSTEXPR std::uint64_t sub_mod(std::uint64_t a, std::uint64_t b, std::uint64_t n)
+{
+  return a >= b ? a - b : a + (n - b);
+}
+
+
+// The constants below are computed at compile time, so these are plain
+// (single return) C++11 constexpr functions.
+
+// n^-1 modulo 2^64 for odd n by Newton's iteration: x = n is correct to
+// 3 bits and every step doubles that.
+constexpr std::uint64_t inverse_step(std::uint64_t n, std::uint64_t x, int steps)
+{
+  return steps == 0 ? x : inverse_step(n, x * (2 - n * x), steps - 1);
+}
+
+constexpr std::uint64_t inverse_pow2(std::uint64_t n)
+{
+  return inverse_step(n, n, 5);
+}
+
+
+// The low word of (r * 2^64 + low) / n for r < n, one bit of low at a
+// time; low is shifted up as its bits are used.
+constexpr std::uint64_t divide_wide(
+  std::uint64_t r, std::uint64_t low, std::uint64_t n, int bits, std::uint64_t q = 0
+)
+{
+  return bits == 0
+    ? q
+    : r >= n - r - (low >> 63)
+      ? divide_wide(r - (n - r - (low >> 63)), low << 1, n, bits - 1, (q << 1) | 1)
+      : divide_wide(r + r + (low >> 63), low << 1, n, bits - 1, q << 1);
+}
+
+
+// r * 2^times modulo n, for r < n.
+constexpr std::uint64_t double_mod(std::uint64_t r, std::uint64_t n, int times)
+{
+  return times == 0
+    ? r
+    : double_mod(r >= n - r ? r - (n - r) : r + r, n, times - 1);
+}
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Reductions.
+//
+// Each reduction stores a residue as a 64-bit "rep" and provides
+//
+//   to_rep(v)    - the rep of v modulo N, for any 64-bit v
+//   from_rep(r)  - the residue a rep stands for, in [0,N)
+//   one()        - the rep of 1
+//   mul(a,b)     - the rep of the product of two reps
+//
+// Addition and subtraction of reps are plain modular addition and
+// subtraction. Reductions with has_lanes also provide add_lanes,
+// sub_lanes and mul_lanes over vectors of reps for the batch functions.
+// select_reduction<N> picks one at compile time. The only division left
+// at runtime is v % N in to_rep for Montgomery with N < 2^32.
+
+// N a power of two: mask.
+template <std::uint64_t N>
+struct mask_reduction
+{
+  static bool const has_lanes = true;
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t to_rep(std::uint64_t v)
+  {
+    return v & (N - 1);
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t from_rep(std::uint64_t r)
+  {
+    return r;
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t one()
+  {
+    return 1 & (N - 1);
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t mul(std::uint64_t a, std::uint64_t b)
+  {
+    return (a * b) & (N - 1);
+  }
+
+  template <typename V>
+  static MRR_MODULO_LANES void add_lanes(V& r, V const& a, V const& b)
+  {
+    r = (a + b) & (N - 1);
+  }
+
+  template <typename V>
+  static MRR_MODULO_LANES void sub_lanes(V& r, V const& a, V const& b)
+  {
+    r = (a - b) & (N - 1);
+  }
+
+  template <typename V>
+  static MRR_MODULO_LANES void mul_lanes(V& r, V const& a, V const& b)
+  {
+    r = (a * b) & (N - 1);
+  }
+};
+
+
+
+// Odd N < 2^32: Montgomery reduction with R = 2^32. Reps are in
+// Montgomery form (v * R mod N) and every product fits in 64 bits, so
+// the vector code only needs 32x32->64-bit multiplies.
+template <std::uint64_t N>
+struct montgomery32_reduction
+{
+  static_assert(N % 2 == 1 && N < (std::uint64_t(1) << 32), "odd N < 2^32 required");
+
+  static bool const has_lanes = true;
+
+  static constexpr std::uint64_t mask = 0xffffffffu;
+  static constexpr std::uint64_t n_inv = inverse_pow2(N) & mask;
+  static constexpr std::uint64_t r1 = (std::uint64_t(1) << 32) % N;
+  static constexpr std::uint64_t r2 = r1 * r1 % N;
+
+  // t * R^-1 mod N for t < N * R. The low halves of t and m * N are
+  // equal, so the difference of their high halves is exact.
+  static MRR_MODULO_CONSTEXPR std::uint64_t redc(std::uint64_t t)
+  {
+    return sub_mod(t >> 32, (((t * n_inv) & mask) * N) >> 32, N);
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t to_rep(std::uint64_t v)
+  {
+    return redc((v % N) * r2);
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t from_rep(std::uint64_t r)
+  {
+    return redc(r);
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t one()
+  {
+    return r1;
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t mul(std::uint64_t a, std::uint64_t b)
+  {
+    return redc(a * b);
+  }
+
+  template <typename V>
+  static MRR_MODULO_LANES void add_lanes(V& r, V const& a, V const& b)
+  {
+    V const s = a + b;
+    r = s - ((s >= N) & N);
+  }
+
+  template <typename V>
+  static MRR_MODULO_LANES void sub_lanes(V& r, V const& a, V const& b)
+  {
+    r = (a - b) + ((a < b) & N);
+  }
+
+  template <typename V>
+  static MRR_MODULO_LANES void mul_lanes(V& r, V const& a, V const& b)
+  {
+    // The masks let the compiler use 32x32->64-bit multiplies.
+    V const t = (a & mask) * (b & mask);
+    V const m = ((t & mask) * n_inv) & mask;
+    V const u = (m * N) >> 32;
+    V const h = t >> 32;
+    r = (h - u) + ((h < u) & N);
+  }
+};
+
+
+
+// Odd N >= 2^32: Montgomery reduction with R = 2^64 and 128-bit
+// products.
+template <std::uint64_t N>
+struct montgomery64_reduction
+{
+  static_assert(N % 2 == 1, "odd N required");
+
+  static bool const has_lanes = false;
+
+  static constexpr std::uint64_t n_inv = inverse_pow2(N);
+  static constexpr std::uint64_t r1 = (0 - N) % N;
+  static constexpr std::uint64_t r2 = double_mod(r1, N, 64);
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t redc(uint128 t)
+  {
+    return sub_mod(t.hi, mul_wide(t.lo * n_inv, N).hi, N);
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t to_rep(std::uint64_t v)
+  {
+    return redc(mul_wide(v, r2));
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t from_rep(std::uint64_t r)
+  {
+    return redc(uint128{ 0, r });
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t one()
+  {
+    return r1;
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t mul(std::uint64_t a, std::uint64_t b)
+  {
+    return redc(mul_wide(a, b));
+  }
+};
+
+
+
+// Even N < 2^32: Barrett reduction. With m = floor(2^64 / N) the
+// estimated quotient of any 64-bit x is at most one too small.
+template <std::uint64_t N>
+struct barrett_reduction
+{
+  static_assert(N < (std::uint64_t(1) << 32), "N < 2^32 required");
+
+  static bool const has_lanes = false;
+
+  static constexpr std::uint64_t m = ~std::uint64_t(0) / N;
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t to_rep(std::uint64_t v)
+  {
+    std::uint64_t const r = v - mul_wide(v, m).hi * N;
+    return r >= N ? r - N : r;
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t from_rep(std::uint64_t r)
+  {
+    return r;
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t one()
+  {
+    return 1;
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t mul(std::uint64_t a, std::uint64_t b)
+  {
+    return to_rep(a * b);
+  }
+};
+
+
+
+// Even N >= 2^32 (not a power of two): Barrett reduction of the 128-bit
+// product with m = floor((2^128 - 1) / N). The estimated quotient of any
+// x < N^2 is again at most one too small, but the remainder before the
+// correction may not fit in 64 bits.
+template <std::uint64_t N>
+struct wide_barrett_reduction
+{
+  static_assert(N >= (std::uint64_t(1) << 32) && N % 2 == 0, "even N >= 2^32 required");
+
+  static bool const has_lanes = false;
+
+  static constexpr std::uint64_t m_hi = ~std::uint64_t(0) / N;
+  static constexpr std::uint64_t m_lo = divide_wide(~std::uint64_t(0) % N, ~std::uint64_t(0), N, 64);
+
+  // x mod N for x < N^2 (or any x with x.hi == 0).
+  static MRR_MODULO_CONSTEXPR std::uint64_t reduce(uint128 x)
+  {
+    // The quotient fits in 64 bits, so only the low word of the
+    // 128-bit column of x * m is needed, with the carries into it.
+    uint128 const ll = mul_wide(x.lo, m_lo);
+    uint128 const lh = mul_wide(x.lo, m_hi);
+    uint128 const hl = mul_wide(x.hi, m_lo);
+    std::uint64_t const mid = ll.hi + lh.lo;
+    std::uint64_t const carry = (mid < ll.hi) + (mid + hl.lo < mid);
+    std::uint64_t const q = lh.hi + hl.hi + x.hi * m_hi + carry;
+
+    uint128 const qn = mul_wide(q, N);
+    std::uint64_t const lo = x.lo - qn.lo;
+    std::uint64_t const hi = x.hi - qn.hi - (x.lo < qn.lo);
+    return hi != 0 || lo >= N ? lo - N : lo;
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t to_rep(std::uint64_t v)
+  {
+    return reduce(uint128{ 0, v });
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t from_rep(std::uint64_t r)
+  {
+    return r;
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t one()
+  {
+    return 1;
+  }
+
+  static MRR_MODULO_CONSTEXPR std::uint64_t mul(std::uint64_t a, std::uint64_t b)
+  {
+    return reduce(mul_wide(a, b));
+  }
+};
+
+
+
+template <std::uint64_t N>
+struct select_reduction
+{
+  static bool const is_pow2 = (N & (N - 1)) == 0;
+  static bool const is_small = N < (std::uint64_t(1) << 32);
+
+  using type =
+    typename std::conditional<is_pow2, mask_reduction<N>,
+    typename std::conditional<N % 2 == 1 && is_small, montgomery32_reduction<N>,
+    typename std::conditional<N % 2 == 1, montgomery64_reduction<N>,
+    typename std::conditional<is_small, barrett_reduction<N>,
+                              wide_barrett_reduction<N>
+    >::type>::type>::type>::type;
+};
+
+
+template <std::uint64_t N>
+constexpr std::uint64_t montgomery32_reduction<N>::mask;
+template <std::uint64_t N>
+constexpr std::uint64_t montgomery32_reduction<N>::n_inv;
+template <std::uint64_t N>
+constexpr std::uint64_t montgomery32_reduction<N>::r1;
+template <std::uint64_t N>
+constexpr std::uint64_t montgomery32_reduction<N>::r2;
+template <std::uint64_t N>
+constexpr std::uint64_t montgomery64_reduction<N>::n_inv;
+template <std::uint64_t N>
+constexpr std::uint64_t montgomery64_reduction<N>::r1;
+template <std::uint64_t N>
+constexpr std::uint64_t montgomery64_reduction<N>::r2;
+template <std::uint64_t N>
+constexpr std::uint64_t barrett_reduction<N>::m;
+template <std::uint64_t N>
+constexpr std::uint64_t wide_barrett_reduction<N>::m_hi;
+template <std::uint64_t N>
+constexpr std::uint64_t wide_barrett_reduction<N>::m_lo;
+
+} // namespace detail
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
 template <std::size_t N, typename IntType = unsigned long long>
 struct modulo
 {
+  static_assert(N != 0, "modulo<0> is undefined");
+
   using value_type = IntType;
+  using reduction = typename detail::select_reduction<N>::type;
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
   modulo() = default;
@@ -24,8 +444,8 @@ struct modulo
   ~modulo() = default;
 
 
-  modulo(value_type const& v)
-    : val(v % N)
+  MRR_MODULO_CONSTEXPR modulo(value_type const& v)
+    : rep_(reduction::to_rep(static_cast<std::uint64_t>(v)))
   {
   }
 
@@ -34,100 +454,401 @@ struct modulo
   void swap(modulo& other)
   {
     using std::swap;
-    swap(val, other.val);
+    swap(rep_, other.rep_);
   }
 
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-  modulo& operator +=(modulo const& rhs)
+  MRR_MODULO_CONSTEXPR modulo& operator +=(modulo const& rhs)
   {
-    val = (val + rhs.val) % N;
+    rep_ = detail::add_mod(rep_, rhs.rep_, N);
     return *this;
   }
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-  modulo& operator -=(modulo const& rhs)
+  MRR_MODULO_CONSTEXPR modulo& operator -=(modulo const& rhs)
   {
-    while(val < rhs.val)
-      val += N;
-
-    val -= rhs.val;
+    rep_ = detail::sub_mod(rep_, rhs.rep_, N);
     return *this;
   }
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-  modulo& operator *=(modulo const& rhs)
+  MRR_MODULO_CONSTEXPR modulo& operator *=(modulo const& rhs)
   {
-    val = (val * rhs.val) % N;
+    rep_ = reduction::mul(rep_, rhs.rep_);
     return *this;
   }
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-  const modulo operator +(value_type const& rhs)
+  template <typename U, typename = typename std::enable_if<std::is_integral<U>::value>::type>
+  MRR_MODULO_CONSTEXPR const modulo operator +(U const& rhs) const
   {
-    return (modulo(*this) += rhs);
+    return (modulo(*this) += modulo(static_cast<value_type>(rhs)));
   }
 
-  const modulo operator +(modulo const& rhs)
+  MRR_MODULO_CONSTEXPR const modulo operator +(modulo const& rhs) const
   {
     return (modulo(*this) += rhs);
   }
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-  const modulo operator -(value_type const& rhs)
+  template <typename U, typename = typename std::enable_if<std::is_integral<U>::value>::type>
+  MRR_MODULO_CONSTEXPR const modulo operator -(U const& rhs) const
   {
-    return (modulo(*this) -= rhs);
+    return (modulo(*this) -= modulo(static_cast<value_type>(rhs)));
   }
 
-  const modulo operator -(modulo const& rhs)
+  MRR_MODULO_CONSTEXPR const modulo operator -(modulo const& rhs) const
   {
     return (modulo(*this) -= rhs);
   }
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-  const modulo operator *(value_type const& rhs)
+  template <typename U, typename = typename std::enable_if<std::is_integral<U>::value>::type>
+  MRR_MODULO_CONSTEXPR const modulo operator *(U const& rhs) const
   {
-    return (modulo(*this) *= rhs);
+    return (modulo(*this) *= modulo(static_cast<value_type>(rhs)));
   }
 
-  const modulo operator *(modulo const& rhs)
+  MRR_MODULO_CONSTEXPR const modulo operator *(modulo const& rhs) const
   {
     return (modulo(*this) *= rhs);
   }
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-  bool operator ==(int const& rhs)
+  // *this to the power e by repeated squaring.
+  MRR_MODULO_CONSTEXPR modulo pow(std::uint64_t e) const
   {
-    return val == modulo(rhs);
+    modulo result = from_rep(reduction::one());
+    modulo base = *this;
+
+    for(; e != 0; e >>= 1)
+    {
+      if(e & 1)
+        result *= base;
+      base *= base;
+    }
+
+    return result;
   }
 
-  bool operator ==(modulo const& rhs)
+  //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+  // The multiplicative inverse, by the extended Euclidean algorithm.
+  // Throws std::domain_error if *this and N are not coprime.
+  MRR_MODULO_CONSTEXPR modulo inverse() const
   {
-    return val == rhs.val;
+    std::uint64_t r0 = N;
+    std::uint64_t r1 = reduction::from_rep(rep_);
+    modulo t0 = from_rep(0);
+    modulo t1 = from_rep(reduction::one());
+
+    while(r1 != 0)
+    {
+      std::uint64_t const q = r0 / r1;
+      std::uint64_t const r = r0 - q * r1;
+      modulo const t = t0 - modulo(q) * t1;
+
+      r0 = r1;
+      r1 = r;
+      t0 = t1;
+      t1 = t;
+    }
+
+    if(r0 != 1)
+      throw std::domain_error("modulo: value has no inverse");
+
+    return t0;
   }
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-  bool operator !=(int const& rhs)
+  template <typename U, typename = typename std::enable_if<std::is_integral<U>::value>::type>
+  MRR_MODULO_CONSTEXPR bool operator ==(U const& rhs) const
+  {
+    return *this == modulo(static_cast<value_type>(rhs));
+  }
+
+  MRR_MODULO_CONSTEXPR bool operator ==(modulo const& rhs) const
   {
-    return !(*this == modulo(rhs));
+    return rep_ == rhs.rep_;
   }
 
-  bool operator !=(modulo const& rhs)
+  //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+  template <typename U, typename = typename std::enable_if<std::is_integral<U>::value>::type>
+  MRR_MODULO_CONSTEXPR bool operator !=(U const& rhs) const
+  {
+    return !(*this == modulo(static_cast<value_type>(rhs)));
+  }
+
+  MRR_MODULO_CONSTEXPR bool operator !=(modulo const& rhs) const
   {
     return !(*this == rhs);
   }
 
   //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-  operator value_type const& () const
+  MRR_MODULO_CONSTEXPR operator value_type () const
   {
-    return val;
+    return static_cast<value_type>(reduction::from_rep(rep_));
   }
 
 
 private:
-  unsigned long long val;
+  static MRR_MODULO_CONSTEXPR modulo from_rep(std::uint64_t r)
+  {
+    modulo m;
+    m.rep_ = r;
+    return m;
+  }
+
+  // The residue in the representation of the reduction, e.g. Montgomery
+  // form. The batch functions work on arrays of these directly.
+  std::uint64_t rep_ = 0;
+};
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Batch operations.
+//
+// d_first[i] = first1[i] op first2[i] (or op c) for every i. The output
+// may be the same array as an input. When the reduction has lane
+// operations (N a power of two or odd N < 2^32) the loop runs over
+// SIMD vectors of residues, dispatched at runtime like simd.hxx.
+
+namespace detail {
+
+struct add_op
+{
+  template <typename Reduction, std::uint64_t N>
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b)
+  {
+    return add_mod(a, b, N);
+  }
+
+  template <typename Reduction, typename V>
+  static MRR_MODULO_LANES void lanes(V& r, V const& a, V const& b)
+  {
+    Reduction::add_lanes(r, a, b);
+  }
+};
+
+struct sub_op
+{
+  template <typename Reduction, std::uint64_t N>
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b)
+  {
+    return sub_mod(a, b, N);
+  }
+
+  template <typename Reduction, typename V>
+  static MRR_MODULO_LANES void lanes(V& r, V const& a, V const& b)
+  {
+    Reduction::sub_lanes(r, a, b);
+  }
 };
 
+struct mul_op
+{
+  template <typename Reduction, std::uint64_t N>
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b)
+  {
+    return Reduction::mul(a, b);
+  }
+
+  template <typename Reduction, typename V>
+  static MRR_MODULO_LANES void lanes(V& r, V const& a, V const& b)
+  {
+    Reduction::mul_lanes(r, a, b);
+  }
+};
+
+
+// b is a single residue when Broadcast, otherwise an array of n.
+template <typename Op, typename Reduction, std::uint64_t N, bool Broadcast>
+void batch_scalar(
+  std::uint64_t const* a, std::uint64_t const* b, std::uint64_t* out, std::size_t n
+)
+{
+  for(std::size_t i = 0; i != n; ++i)
+    out[i] = Op::template apply<Reduction,N>(a[i], Broadcast ? *b : b[i]);
+}
+
+
+#ifdef MRR_SIMD_ENABLED
+
+template <typename Op, typename Reduction, std::uint64_t N, bool Broadcast, std::size_t Bytes>
+MRR_SIMD_INLINE void batch_kernel(
+  std::uint64_t const* a, std::uint64_t const* b, std::uint64_t* out, std::size_t n
+)
+{
+  using vec = typename simd::detail::vector_of<std::uint64_t,Bytes>::type;
+  std::size_t const width = simd::detail::vector_of<std::uint64_t,Bytes>::width;
+
+  vec broadcast = {};
+  if(Broadcast)
+    for(std::size_t lane = 0; lane != width; ++lane)
+      broadcast[lane] = *b;
+
+  std::size_t i = 0;
+  for(; i + width <= n; i += width)
+  {
+    vec x, y = broadcast, r;
+    std::memcpy(&x, a + i, sizeof(vec));
+    if(!Broadcast)
+      std::memcpy(&y, b + i, sizeof(vec));
+    Op::template lanes<Reduction>(r, x, y);
+    std::memcpy(out + i, &r, sizeof(vec));
+  }
+
+  for(; i != n; ++i)
+    out[i] = Op::template apply<Reduction,N>(a[i], Broadcast ? *b : b[i]);
+}
+
+
+template <typename Op, typename Reduction, std::uint64_t N, bool Broadcast>
+void batch_base(std::uint64_t const* a, std::uint64_t const* b, std::uint64_t* out, std::size_t n)
+{
+  batch_kernel<Op,Reduction,N,Broadcast,16>(a,b,out,n);
+}
+
+#ifdef MRR_SIMD_X86
+
+template <typename Op, typename Reduction, std::uint64_t N, bool Broadcast>
+MRR_SIMD_TARGET("avx2")
+void batch_avx2(std::uint64_t const* a, std::uint64_t const* b, std::uint64_t* out, std::size_t n)
+{
+  batch_kernel<Op,Reduction,N,Broadcast,32>(a,b,out,n);
+}
+
+template <typename Op, typename Reduction, std::uint64_t N, bool Broadcast>
+MRR_SIMD_TARGET("avx512f")
+void batch_avx512(std::uint64_t const* a, std::uint64_t const* b, std::uint64_t* out, std::size_t n)
+{
+  batch_kernel<Op,Reduction,N,Broadcast,64>(a,b,out,n);
+}
+
+#endif // #ifdef MRR_SIMD_X86
+
+
+template <typename Op, typename Reduction, std::uint64_t N, bool Broadcast>
+void batch(
+  std::uint64_t const* a, std::uint64_t const* b, std::uint64_t* out, std::size_t n,
+  std::true_type
+)
+{
+#ifdef MRR_SIMD_X86
+  switch (simd::detail::detected_isa())
+  {
+    case simd::detail::isa::avx512: return batch_avx512<Op,Reduction,N,Broadcast>(a,b,out,n);
+    case simd::detail::isa::avx2:   return batch_avx2<Op,Reduction,N,Broadcast>(a,b,out,n);
+    case simd::detail::isa::base:   break;
+  }
+#endif
+  batch_base<Op,Reduction,N,Broadcast>(a,b,out,n);
+}
+
+#endif // #ifdef MRR_SIMD_ENABLED
+
+
+template <typename Op, typename Reduction, std::uint64_t N, bool Broadcast>
+void batch(
+  std::uint64_t const* a, std::uint64_t const* b, std::uint64_t* out, std::size_t n,
+  std::false_type
+)
+{
+  batch_scalar<Op,Reduction,N,Broadcast>(a,b,out,n);
+}
+
+
+template <typename Op, bool Broadcast, std::size_t N, typename IntType>
+void batch(
+  modulo<N,IntType> const* first1, modulo<N,IntType> const* last1,
+  modulo<N,IntType> const* b,
+  modulo<N,IntType>* d_first
+)
+{
+  using type = modulo<N,IntType>;
+  using reduction = typename type::reduction;
+
+  static_assert(
+    std::is_standard_layout<type>::value && sizeof(type) == sizeof(std::uint64_t),
+    "modulo must be layout compatible with its residue"
+  );
+
+#ifdef MRR_SIMD_ENABLED
+  using use_lanes = std::integral_constant<bool, reduction::has_lanes>;
+#else
+  using use_lanes = std::false_type;
+#endif
+
+  batch<Op,reduction,N,Broadcast>(
+    reinterpret_cast<std::uint64_t const*>(first1),
+    reinterpret_cast<std::uint64_t const*>(b),
+    reinterpret_cast<std::uint64_t*>(d_first),
+    static_cast<std::size_t>(last1 - first1),
+    use_lanes()
+  );
+}
+
+} // namespace detail
+
+
+
+template <std::size_t N, typename IntType>
+void batch_add(
+  modulo<N,IntType> const* first1, modulo<N,IntType> const* last1,
+  modulo<N,IntType> const* first2, modulo<N,IntType>* d_first
+)
+{
+  detail::batch<detail::add_op,false>(first1, last1, first2, d_first);
+}
+
+template <std::size_t N, typename IntType>
+void batch_add(
+  modulo<N,IntType> const* first, modulo<N,IntType> const* last,
+  modulo<N,IntType> const& c, modulo<N,IntType>* d_first
+)
+{
+  detail::batch<detail::add_op,true>(first, last, &c, d_first);
+}
+
+
+template <std::size_t N, typename IntType>
+void batch_sub(
+  modulo<N,IntType> const* first1, modulo<N,IntType> const* last1,
+  modulo<N,IntType> const* first2, modulo<N,IntType>* d_first
+)
+{
+  detail::batch<detail::sub_op,false>(first1, last1, first2, d_first);
+}
+
+template <std::size_t N, typename IntType>
+void batch_sub(
+  modulo<N,IntType> const* first, modulo<N,IntType> const* last,
+  modulo<N,IntType> const& c, modulo<N,IntType>* d_first
+)
+{
+  detail::batch<detail::sub_op,true>(first, last, &c, d_first);
+}
+
+
+template <std::size_t N, typename IntType>
+void batch_mul(
+  modulo<N,IntType> const* first1, modulo<N,IntType> const* last1,
+  modulo<N,IntType> const* first2, modulo<N,IntType>* d_first
+)
+{
+  detail::batch<detail::mul_op,false>(first1, last1, first2, d_first);
+}
+
+template <std::size_t N, typename IntType>
+void batch_mul(
+  modulo<N,IntType> const* first, modulo<N,IntType> const* last,
+  modulo<N,IntType> const& c, modulo<N,IntType>* d_first
+)
+{
+  detail::batch<detail::mul_op,true>(first, last, &c, d_first);
+}
+
 
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
@@ -1,7 +1,30 @@
 #ifndef MRR_CXX_UTILS_MONITOR_HXX_
 #define MRR_CXX_UTILS_MONITOR_HXX_
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201402L
+#  include <shared_mutex>
+#endif
+
+#include "mpsc_queue.hxx"
+
+// rcu_monitor keeps its object in a std::atomic<std::shared_ptr> where
+// the standard library has one (C++20).
+#if defined(__cpp_lib_atomic_shared_ptr)
+#  define MRR_MONITOR_ATOMIC_SHARED_PTR 1
+#endif
 
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
@@ -64,6 +87,432 @@ public:
 };
 
 
+#if __cplusplus >= 201402L
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Reader/writer monitor. Functions that can be called with a T const&
+// only read the object and run under a shared lock, concurrently with
+// each other; the rest get a T& under an exclusive lock. read() and
+// write() pick the lock explicitly.
+//
+// A generic lambda taking auto& is deduced as a reader, and fails to
+// compile if it modifies the object; use write() for those.
+template <typename T>
+class shared_monitor
+{
+private:
+#if __cplusplus >= 201703L
+  using mutex_type = std::shared_mutex;
+#else
+  using mutex_type = std::shared_timed_mutex;
+#endif
+
+  mutable T t_;
+  mutable mutex_type m_;
+
+  template <typename F>
+  auto dispatch(F&& f, int) const
+    -> decltype(std::forward<F>(f)(std::declval<T const&>()))
+  {
+    return read(std::forward<F>(f));
+  }
+
+  template <typename F>
+  auto dispatch(F&& f, long) const
+    -> decltype(std::forward<F>(f)(t_))
+  {
+    return write(std::forward<F>(f));
+  }
+
+public:
+  shared_monitor()
+    : t_{}
+  {
+  }
+
+  shared_monitor(T const& t)
+    : t_{t}
+  {
+  }
+
+  shared_monitor(T&& t)
+    : t_{std::move(t)}
+  {
+  }
+
+  shared_monitor(shared_monitor const&) = delete;
+  shared_monitor(shared_monitor&&) = delete;
+  shared_monitor& operator =(shared_monitor const&) = delete;
+  shared_monitor& operator =(shared_monitor&&) = delete;
+
+  T object() const
+  {
+    std::shared_lock<mutex_type> guard{m_};
+    return t_;
+  }
+
+  template <typename F>
+  auto read(F&& f) const
+    -> decltype(std::forward<F>(f)(std::declval<T const&>()))
+  {
+    std::shared_lock<mutex_type> guard{m_};
+    return std::forward<F>(f)(static_cast<T const&>(t_));
+  }
+
+  template <typename F>
+  auto write(F&& f) const
+    -> decltype(std::forward<F>(f)(t_))
+  {
+    std::lock_guard<mutex_type> guard{m_};
+    return std::forward<F>(f)(t_);
+  }
+
+  template <typename F>
+  auto operator ()(F&& f) const
+    -> decltype(this->dispatch(std::forward<F>(f), 0))
+  {
+    return dispatch(std::forward<F>(f), 0);
+  }
+
+};
+
+#endif // #if __cplusplus >= 201402L
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Sequence lock monitor for small trivially copyable state. Readers
+// never block or write shared memory: they copy the object and retry if
+// a writer ran in the meantime. Writers are serialized by a mutex.
+//
+// The object is kept as relaxed atomic words so a copy racing with a
+// write is not a data race; fences order the words against the
+// sequence number (Boehm, "Can Seqlocks Get Along with Programming
+// Language Memory Models?").
+template <typename T>
+class seqlock_monitor
+{
+  static_assert(
+    std::is_trivially_copyable<T>::value,
+    "seqlock_monitor requires a trivially copyable type"
+  );
+  static_assert(
+    std::is_default_constructible<T>::value,
+    "seqlock_monitor requires a default constructible type"
+  );
+
+private:
+  using word_type = std::uintptr_t;
+  static std::size_t const num_words =
+    (sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+
+  std::atomic<unsigned> seq_;
+  std::atomic<word_type> words_[num_words];
+  std::mutex writer_m_;
+
+  void write_words(T const& t)
+  {
+    word_type buffer[num_words] = {};
+    std::memcpy(buffer, &t, sizeof(T));
+
+    unsigned const seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t i = 0; i != num_words; ++i)
+      words_[i].store(buffer[i], std::memory_order_relaxed);
+
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+public:
+  seqlock_monitor()
+    : seq_(0)
+  {
+    write_words(T{});
+  }
+
+  seqlock_monitor(T const& t)
+    : seq_(0)
+  {
+    write_words(t);
+  }
+
+  seqlock_monitor(seqlock_monitor const&) = delete;
+  seqlock_monitor(seqlock_monitor&&) = delete;
+  seqlock_monitor& operator =(seqlock_monitor const&) = delete;
+  seqlock_monitor& operator =(seqlock_monitor&&) = delete;
+
+  T load() const
+  {
+    word_type buffer[num_words];
+
+    for (;;)
+    {
+      unsigned const before = seq_.load(std::memory_order_acquire);
+      if (before & 1)
+        continue;
+
+      for (std::size_t i = 0; i != num_words; ++i)
+        buffer[i] = words_[i].load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == before)
+        break;
+    }
+
+    T t;
+    std::memcpy(&t, buffer, sizeof(T));
+    return t;
+  }
+
+  void store(T const& t)
+  {
+    std::lock_guard<std::mutex> guard{writer_m_};
+    write_words(t);
+  }
+
+  T object() const
+  {
+    return load();
+  }
+
+  // Run f on a snapshot of the object.
+  template <typename F>
+  auto operator ()(F&& f) const
+    -> decltype(std::forward<F>(f)(std::declval<T const&>()))
+  {
+    T const t = load();
+    return std::forward<F>(f)(t);
+  }
+
+  // Apply f to a copy of the object and publish the result.
+  template <typename F>
+  void update(F&& f)
+  {
+    std::lock_guard<std::mutex> guard{writer_m_};
+    T t = load();
+    std::forward<F>(f)(t);
+    write_words(t);
+  }
+
+};
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Read-copy-update monitor for state of any size. Readers take a
+// reference counted snapshot of the current object and keep it for as
+// long as they need; writers copy it, modify the copy and swap it in.
+// Old versions are freed when their last reader lets go. Readers never
+// wait for a writer copying the object, but every read still updates
+// the reference count, so readers on many cores contend for its cache
+// line.
+//
+// Without std::atomic<std::shared_ptr> the pointer is read and written
+// with std::atomic_load and std::atomic_store. libstdc++ and libc++
+// implement those with a global table of mutexes, so there readers take
+// a short lock too and this is a locking fallback.
+template <typename T>
+class rcu_monitor
+{
+private:
+#ifdef MRR_MONITOR_ATOMIC_SHARED_PTR
+  std::atomic<std::shared_ptr<T const> > current_;
+#else
+  std::shared_ptr<T const> current_;
+#endif
+  std::mutex writer_m_;
+
+  void publish(std::shared_ptr<T const> next)
+  {
+#ifdef MRR_MONITOR_ATOMIC_SHARED_PTR
+    current_.store(std::move(next), std::memory_order_release);
+#else
+    std::atomic_store(&current_, std::move(next));
+#endif
+  }
+
+public:
+  rcu_monitor()
+    : current_(std::make_shared<T const>())
+  {
+  }
+
+  rcu_monitor(T const& t)
+    : current_(std::make_shared<T const>(t))
+  {
+  }
+
+  rcu_monitor(T&& t)
+    : current_(std::make_shared<T const>(std::move(t)))
+  {
+  }
+
+  rcu_monitor(rcu_monitor const&) = delete;
+  rcu_monitor(rcu_monitor&&) = delete;
+  rcu_monitor& operator =(rcu_monitor const&) = delete;
+  rcu_monitor& operator =(rcu_monitor&&) = delete;
+
+  std::shared_ptr<T const> snapshot() const
+  {
+#ifdef MRR_MONITOR_ATOMIC_SHARED_PTR
+    return current_.load(std::memory_order_acquire);
+#else
+    return std::atomic_load(&current_);
+#endif
+  }
+
+  T object() const
+  {
+    return *snapshot();
+  }
+
+  template <typename F>
+  auto operator ()(F&& f) const
+    -> decltype(std::forward<F>(f)(std::declval<T const&>()))
+  {
+    std::shared_ptr<T const> const t = snapshot();
+    return std::forward<F>(f)(*t);
+  }
+
+  void store(T t)
+  {
+    std::shared_ptr<T const> next = std::make_shared<T const>(std::move(t));
+
+    std::lock_guard<std::mutex> guard{writer_m_};
+    publish(std::move(next));
+  }
+
+  // Apply f to a copy of the object and publish the result.
+  template <typename F>
+  void update(F&& f)
+  {
+    std::lock_guard<std::mutex> guard{writer_m_};
+
+    std::shared_ptr<T> next = std::make_shared<T>(*snapshot());
+    std::forward<F>(f)(*next);
+    publish(std::move(next));
+  }
+
+};
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Sutter's concurrent<T> (named async_monitor here as mrr::concurrent is
+// the namespace of the parallel algorithms). Every function is run on a
+// dedicated worker thread, in submission order, and the caller gets a
+// future for the result instead of waiting for a lock. Work is handed
+// over through a lock-free queue; the worker only sleeps when the queue
+// is empty.
+template <typename T>
+class async_monitor
+{
+private:
+  using task_type = std::function<void()>;
+
+  mutable T t_;
+  mutable mpsc_queue<task_type> q_;
+  mutable std::atomic<bool> sleeping_;
+  mutable std::mutex sleep_m_;
+  mutable std::condition_variable sleep_cv_;
+  bool done_;
+  std::thread worker_;
+
+  template <typename R, typename F>
+  static void set_value(std::promise<R>& p, F& f, T& t)
+  {
+    p.set_value(f(t));
+  }
+
+  template <typename F>
+  static void set_value(std::promise<void>& p, F& f, T& t)
+  {
+    f(t);
+    p.set_value();
+  }
+
+  void push(task_type task) const
+  {
+    q_.push(std::move(task));
+
+    if (sleeping_.load())
+    {
+      std::lock_guard<std::mutex> guard{sleep_m_};
+      sleep_cv_.notify_one();
+    }
+  }
+
+  void run()
+  {
+    task_type task;
+
+    while (!done_)
+    {
+      if (q_.pop(task))
+      {
+        task();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock{sleep_m_};
+      sleeping_.store(true);
+      sleep_cv_.wait(lock, [this] { return !q_.empty(); });
+      sleeping_.store(false);
+    }
+  }
+
+public:
+  async_monitor()
+    : async_monitor(T{})
+  {
+  }
+
+  async_monitor(T t)
+    : t_(std::move(t)), sleeping_(false), done_(false),
+      worker_(&async_monitor::run, this)
+  {
+  }
+
+  async_monitor(async_monitor const&) = delete;
+  async_monitor(async_monitor&&) = delete;
+  async_monitor& operator =(async_monitor const&) = delete;
+  async_monitor& operator =(async_monitor&&) = delete;
+
+  // Runs the functions already queued before stopping the worker.
+  ~async_monitor()
+  {
+    push([this] { done_ = true; });
+    worker_.join();
+  }
+
+  template <typename F>
+  auto operator ()(F f) const
+    -> std::future<decltype(f(t_))>
+  {
+    using result_type = decltype(f(t_));
+
+    auto p = std::make_shared<std::promise<result_type> >();
+    std::future<result_type> result = p->get_future();
+
+    push([this, p, f]() mutable {
+      try
+      {
+        set_value(*p, f, t_);
+      }
+      catch (...)
+      {
+        p->set_exception(std::current_exception());
+      }
+    });
+
+    return result;
+  }
+
+};
+
+
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
 } // namespace mrr
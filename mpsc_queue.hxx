@@ -0,0 +1,99 @@
+#ifndef MRR_CXX_UTILS_MPSC_QUEUE_HXX_
+#define MRR_CXX_UTILS_MPSC_QUEUE_HXX_
+
+#include <atomic>
+#include <utility>
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+namespace mrr {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+// Unbounded lock-free multiple producer, single consumer queue
+// (Dmitry Vyukov's intrusive MPSC queue). push() may be called from any
+// thread, pop() and empty() only from the one consumer thread.
+//
+// A pop() racing with a push() can briefly see the queue as empty; the
+// link to a pushed node is stored sequentially consistent so a consumer
+// that announces it is going to sleep before checking empty() cannot
+// miss a producer that checks for a sleeping consumer after push().
+template <typename T>
+class mpsc_queue
+{
+private:
+  struct node
+  {
+    node()
+      : next(nullptr), value()
+    {
+    }
+
+    explicit node(T&& v)
+      : next(nullptr), value(std::move(v))
+    {
+    }
+
+    std::atomic<node*> next;
+    T value;
+  };
+
+  std::atomic<node*> head_;
+  node* tail_;
+
+public:
+  mpsc_queue()
+    : head_(new node), tail_(head_.load())
+  {
+  }
+
+  mpsc_queue(mpsc_queue const&) = delete;
+  mpsc_queue(mpsc_queue&&) = delete;
+  mpsc_queue& operator =(mpsc_queue const&) = delete;
+  mpsc_queue& operator =(mpsc_queue&&) = delete;
+
+  ~mpsc_queue()
+  {
+    T value;
+    while (pop(value))
+      ;
+    delete tail_;
+  }
+
+  void push(T value)
+  {
+    node* n = new node(std::move(value));
+    node* prev = head_.exchange(n, std::memory_order_acq_rel);
+    prev->next.store(n);
+  }
+
+  bool pop(T& value)
+  {
+    node* tail = tail_;
+    node* next = tail->next.load();
+
+    if (next == nullptr)
+      return false;
+
+    value = std::move(next->value);
+    tail_ = next;
+    delete tail;
+    return true;
+  }
+
+  bool empty() const
+  {
+    return tail_->next.load() == nullptr;
+  }
+};
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+} // namespace mrr
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+#endif // MRR_CXX_UTILS_MPSC_QUEUE_HXX_
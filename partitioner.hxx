@@ -0,0 +1,173 @@
+//===========================================================================
+// Copyright (c) 2012 Matt Renaud. All Rights Reserved.
+//
+//===========================================================================
+
+#ifndef MRR_CONCURRENT_PARTITIONER_HXX_
+#define MRR_CONCURRENT_PARTITIONER_HXX_
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+namespace mrr {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Concurrent Algorithms.
+
+namespace concurrent {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Partitioners
+//
+// A partitioner decides how in_parallel splits a range. It provides:
+//
+//   std::size_t sequential_cutoff() const;
+//     Ranges no longer than this are processed on the calling thread.
+//
+//   std::size_t num_blocks(std::size_t length, unsigned num_threads) const;
+//     The number of (near) equal blocks to split a range of the given
+//     length into when num_threads threads are available.
+//
+// The blocks are handed to the pool by recursive splitting, so having
+// many more blocks than threads lets work-stealing even out blocks with
+// skewed per-element cost.
+
+std::size_t const default_sequential_cutoff = 1024;
+std::size_t const default_grain_size = 1024;
+
+
+// One block per thread. Cheapest when every element costs the same.
+class static_partitioner
+{
+public:
+  explicit static_partitioner(
+    std::size_t sequential_cutoff = default_sequential_cutoff
+  )
+    : cutoff_(sequential_cutoff)
+  {
+  }
+
+  std::size_t sequential_cutoff() const
+  {
+    return cutoff_;
+  }
+
+  std::size_t num_blocks(std::size_t length, unsigned num_threads) const
+  {
+    return std::max<std::size_t>(1, std::min<std::size_t>(length, num_threads));
+  }
+
+private:
+  std::size_t cutoff_;
+};
+
+
+
+// Blocks of (about) grain_size elements, however many threads there are.
+class fixed_partitioner
+{
+public:
+  explicit fixed_partitioner(
+    std::size_t grain_size,
+    std::size_t sequential_cutoff = default_sequential_cutoff
+  )
+    : grain_(std::max<std::size_t>(1, grain_size)), cutoff_(sequential_cutoff)
+  {
+  }
+
+  std::size_t sequential_cutoff() const
+  {
+    return cutoff_;
+  }
+
+  std::size_t num_blocks(std::size_t length, unsigned) const
+  {
+    return std::max<std::size_t>(1, (length + grain_ - 1) / grain_);
+  }
+
+private:
+  std::size_t grain_;
+  std::size_t cutoff_;
+};
+
+
+
+// Several blocks per thread so stealing can balance skewed work, but
+// never blocks smaller than min_grain_size. This is the default.
+class adaptive_partitioner
+{
+public:
+  static unsigned const blocks_per_thread = 8;
+
+  explicit adaptive_partitioner(
+    std::size_t min_grain_size = default_grain_size,
+    std::size_t sequential_cutoff = default_sequential_cutoff
+  )
+    : grain_(std::max<std::size_t>(1, min_grain_size)), cutoff_(sequential_cutoff)
+  {
+  }
+
+  std::size_t sequential_cutoff() const
+  {
+    return cutoff_;
+  }
+
+  std::size_t num_blocks(std::size_t length, unsigned num_threads) const
+  {
+    std::size_t const by_grain = length / grain_;
+    std::size_t const by_threads =
+      static_cast<std::size_t>(num_threads) * blocks_per_thread;
+
+    return std::max<std::size_t>(1, std::min(by_grain, by_threads));
+  }
+
+private:
+  std::size_t grain_;
+  std::size_t cutoff_;
+};
+
+
+
+// Whether T provides the partitioner interface. Used to keep the
+// partitioner overloads of the algorithms out of overload resolution
+// when an iterator would otherwise be deduced as the partitioner.
+template <typename T>
+class is_partitioner
+{
+  template <typename U>
+  static auto test(int)
+    -> decltype(
+         std::declval<U const&>().sequential_cutoff(),
+         std::declval<U const&>().num_blocks(std::size_t(), 1u),
+         std::true_type()
+       );
+
+  template <typename>
+  static std::false_type test(...);
+
+public:
+  static bool const value = decltype(test<T>(0))::value;
+};
+
+
+//m----------------------------------------------------------------------
+} // namespace concurrent
+//-----------------------------------------------------------------------
+
+
+//m----------------------------------------------------------------------
+} // namespace mrr
+//-----------------------------------------------------------------------
+
+
+#endif // #ifndef MRR_CONCURRENT_PARTITIONER_HXX_
@@ -0,0 +1,513 @@
+//===========================================================================
+// Copyright (c) 2012 Matt Renaud. All Rights Reserved.
+//
+//===========================================================================
+
+#ifndef MRR_CXX_UTILS_SIMD_HXX_
+#define MRR_CXX_UTILS_SIMD_HXX_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+// The kernels are written with the GCC/Clang vector extensions and built
+// for each instruction set with the target attribute, so no extra
+// compiler flags are needed. Define MRR_SIMD_DISABLE to always use the
+// scalar code.
+#if defined(__GNUC__) && !defined(MRR_SIMD_DISABLE)
+#  define MRR_SIMD_ENABLED 1
+#  define MRR_SIMD_INLINE inline __attribute__((always_inline))
+#  if defined(__x86_64__) || defined(__i386__)
+#    define MRR_SIMD_X86 1
+#    define MRR_SIMD_TARGET(isa) __attribute__((target(isa)))
+#  endif
+#endif
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+namespace mrr {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// SIMD kernels for reductions over contiguous arithmetic ranges.
+
+namespace simd {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Traits
+
+// 32 and 64-bit integer and floating point types.
+template <typename T>
+struct is_vectorizable
+  : std::integral_constant<
+      bool,
+      std::is_arithmetic<T>::value
+        && !std::is_same<T, bool>::value
+        && (sizeof(T) == 4 || sizeof(T) == 8)
+    >
+{
+};
+
+
+// Pointers and std::vector iterators. There is no contiguous iterator
+// category before C++20, so other contiguous containers use the scalar
+// code unless their iterators are plain pointers.
+template <
+  typename Iterator,
+  typename Value = typename std::iterator_traits<Iterator>::value_type
+>
+struct is_contiguous_iterator
+  : std::integral_constant<
+      bool,
+      std::is_pointer<Iterator>::value
+        || std::is_same<Iterator, typename std::vector<Value>::iterator>::value
+        || std::is_same<Iterator, typename std::vector<Value>::const_iterator>::value
+    >
+{
+};
+
+
+// Whether the kernels can be used on [first,last) of Iterator.
+template <typename Iterator>
+struct is_simd_range
+  : std::integral_constant<
+      bool,
+      is_contiguous_iterator<Iterator>::value
+        && is_vectorizable<
+             typename std::iterator_traits<Iterator>::value_type
+           >::value
+    >
+{
+};
+
+
+
+#ifdef MRR_SIMD_ENABLED
+
+namespace detail {
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Generic kernels. Bytes is the vector width; the kernels are force
+// inlined into the per-instruction-set entry points below so the vector
+// code is generated for that instruction set.
+
+template <typename T, std::size_t Bytes>
+struct vector_of
+{
+  typedef T type __attribute__((vector_size(Bytes)));
+  static std::size_t const width = Bytes / sizeof(T);
+};
+
+
+// The count and extremum kernels keep per-lane counters and indices in
+// lanes as wide as T, so they are never given more than this many
+// elements at once.
+std::size_t const max_chunk = std::size_t(1) << 30;
+
+
+template <typename T, std::size_t Bytes>
+MRR_SIMD_INLINE T sum_kernel(T const* p, std::size_t n)
+{
+  using vec = typename vector_of<T,Bytes>::type;
+  std::size_t const width = vector_of<T,Bytes>::width;
+
+  // Independent accumulators hide the latency of the adds.
+  vec acc0 = {}, acc1 = {}, acc2 = {}, acc3 = {};
+  std::size_t i = 0;
+
+  for (; i + 4*width <= n; i += 4*width)
+  {
+    vec x0, x1, x2, x3;
+    std::memcpy(&x0, p + i, sizeof(vec));
+    std::memcpy(&x1, p + i + width, sizeof(vec));
+    std::memcpy(&x2, p + i + 2*width, sizeof(vec));
+    std::memcpy(&x3, p + i + 3*width, sizeof(vec));
+    acc0 += x0;
+    acc1 += x1;
+    acc2 += x2;
+    acc3 += x3;
+  }
+
+  for (; i + width <= n; i += width)
+  {
+    vec x;
+    std::memcpy(&x, p + i, sizeof(vec));
+    acc0 += x;
+  }
+
+  acc0 += acc1 + acc2 + acc3;
+
+  T sum = T();
+  for (std::size_t lane = 0; lane != width; ++lane)
+    sum += acc0[lane];
+  for (; i != n; ++i)
+    sum += p[i];
+
+  return sum;
+}
+
+
+template <typename T, std::size_t Bytes>
+MRR_SIMD_INLINE std::size_t count_kernel(T const* p, std::size_t n, T value)
+{
+  using vec = typename vector_of<T,Bytes>::type;
+  std::size_t const width = vector_of<T,Bytes>::width;
+
+  vec target;
+  for (std::size_t lane = 0; lane != width; ++lane)
+    target[lane] = value;
+
+  // Matching lanes compare to -1.
+  decltype(target == target) matches = {};
+  std::size_t i = 0;
+
+  for (; i + width <= n; i += width)
+  {
+    vec x;
+    std::memcpy(&x, p + i, sizeof(vec));
+    matches -= (x == target);
+  }
+
+  std::size_t count = 0;
+  for (std::size_t lane = 0; lane != width; ++lane)
+    count += static_cast<std::size_t>(matches[lane]);
+  for (; i != n; ++i)
+    count += (p[i] == value);
+
+  return count;
+}
+
+
+// Index of the first largest (Max) or smallest (!Max) element of a
+// non-empty range, or -1 if the range holds a NaN, in which case the
+// caller falls back to the standard algorithm to get its exact answer.
+template <typename T, std::size_t Bytes, bool Max>
+MRR_SIMD_INLINE std::ptrdiff_t extremum_kernel(T const* p, std::size_t n)
+{
+  using vec = typename vector_of<T,Bytes>::type;
+  std::size_t const width = vector_of<T,Bytes>::width;
+
+  T best = p[0];
+  std::size_t best_index = 0;
+  std::size_t i = 0;
+
+  if (n >= width)
+  {
+    using mask = decltype(vec() == vec());
+
+    vec best_lanes;
+    mask best_indices, indices, step, nans = {};
+
+    std::memcpy(&best_lanes, p, sizeof(vec));
+    for (std::size_t lane = 0; lane != width; ++lane)
+    {
+      best_indices[lane] = lane;
+      step[lane] = width;
+    }
+    nans |= (best_lanes != best_lanes);
+    indices = best_indices;
+
+    // Only strictly better elements replace a lane's best, so each lane
+    // keeps the first of equal elements.
+    for (i = width; i + width <= n; i += width)
+    {
+      vec x;
+      std::memcpy(&x, p + i, sizeof(vec));
+      indices += step;
+
+      mask const better = Max ? (x > best_lanes) : (x < best_lanes);
+      best_lanes = (vec)(((mask)x & better) | ((mask)best_lanes & ~better));
+      best_indices = (indices & better) | (best_indices & ~better);
+      nans |= (x != x);
+    }
+
+    for (std::size_t lane = 0; lane != width; ++lane)
+      if (nans[lane])
+        return -1;
+
+    best = best_lanes[0];
+    best_index = best_indices[0];
+    for (std::size_t lane = 1; lane != width; ++lane)
+    {
+      T const v = best_lanes[lane];
+      std::size_t const index = best_indices[lane];
+
+      if ((Max ? best < v : v < best) || (v == best && index < best_index))
+      {
+        best = v;
+        best_index = index;
+      }
+    }
+  }
+
+  for (; i != n; ++i)
+  {
+    if (p[i] != p[i])
+      return -1;
+
+    if (Max ? best < p[i] : p[i] < best)
+    {
+      best = p[i];
+      best_index = i;
+    }
+  }
+
+  return static_cast<std::ptrdiff_t>(best_index);
+}
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Per instruction set entry points.
+
+// 16 byte vectors are SSE2 on x86-64 and NEON on ARM.
+template <typename T>
+T sum_base(T const* p, std::size_t n)
+{
+  return sum_kernel<T,16>(p,n);
+}
+
+template <typename T>
+std::size_t count_base(T const* p, std::size_t n, T value)
+{
+  return count_kernel<T,16>(p,n,value);
+}
+
+template <typename T, bool Max>
+std::ptrdiff_t extremum_base(T const* p, std::size_t n)
+{
+  return extremum_kernel<T,16,Max>(p,n);
+}
+
+
+#ifdef MRR_SIMD_X86
+
+template <typename T>
+MRR_SIMD_TARGET("avx2")
+T sum_avx2(T const* p, std::size_t n)
+{
+  return sum_kernel<T,32>(p,n);
+}
+
+template <typename T>
+MRR_SIMD_TARGET("avx2")
+std::size_t count_avx2(T const* p, std::size_t n, T value)
+{
+  return count_kernel<T,32>(p,n,value);
+}
+
+template <typename T, bool Max>
+MRR_SIMD_TARGET("avx2")
+std::ptrdiff_t extremum_avx2(T const* p, std::size_t n)
+{
+  return extremum_kernel<T,32,Max>(p,n);
+}
+
+
+template <typename T>
+MRR_SIMD_TARGET("avx512f")
+T sum_avx512(T const* p, std::size_t n)
+{
+  return sum_kernel<T,64>(p,n);
+}
+
+template <typename T>
+MRR_SIMD_TARGET("avx512f")
+std::size_t count_avx512(T const* p, std::size_t n, T value)
+{
+  return count_kernel<T,64>(p,n,value);
+}
+
+template <typename T, bool Max>
+MRR_SIMD_TARGET("avx512f")
+std::ptrdiff_t extremum_avx512(T const* p, std::size_t n)
+{
+  return extremum_kernel<T,64,Max>(p,n);
+}
+
+#endif // #ifdef MRR_SIMD_X86
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Runtime dispatch.
+
+enum class isa { base, avx2, avx512 };
+
+// The widest instruction set the CPU supports, checked once.
+inline isa detected_isa()
+{
+#ifdef MRR_SIMD_X86
+  static isa const level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+      return isa::avx512;
+    if (__builtin_cpu_supports("avx2"))
+      return isa::avx2;
+    return isa::base;
+  }();
+  return level;
+#else
+  return isa::base;
+#endif
+}
+
+
+template <typename T>
+T sum(T const* p, std::size_t n)
+{
+#ifdef MRR_SIMD_X86
+  switch (detected_isa())
+  {
+    case isa::avx512: return sum_avx512(p,n);
+    case isa::avx2:   return sum_avx2(p,n);
+    case isa::base:   break;
+  }
+#endif
+  return sum_base(p,n);
+}
+
+template <typename T>
+std::size_t count(T const* p, std::size_t n, T value)
+{
+#ifdef MRR_SIMD_X86
+  switch (detected_isa())
+  {
+    case isa::avx512: return count_avx512(p,n,value);
+    case isa::avx2:   return count_avx2(p,n,value);
+    case isa::base:   break;
+  }
+#endif
+  return count_base(p,n,value);
+}
+
+template <typename T, bool Max>
+std::ptrdiff_t extremum(T const* p, std::size_t n)
+{
+#ifdef MRR_SIMD_X86
+  switch (detected_isa())
+  {
+    case isa::avx512: return extremum_avx512<T,Max>(p,n);
+    case isa::avx2:   return extremum_avx2<T,Max>(p,n);
+    case isa::base:   break;
+  }
+#endif
+  return extremum_base<T,Max>(p,n);
+}
+
+
+//m----------------------------------------------------------------------
+} // namespace detail
+//-----------------------------------------------------------------------
+
+#endif // #ifdef MRR_SIMD_ENABLED
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Reductions over [first,last). Floating point sums are reassociated
+// across the vector lanes, so they can differ from std::accumulate in
+// the last bits.
+
+template <typename T>
+T sum(T const* first, T const* last)
+{
+#ifdef MRR_SIMD_ENABLED
+  return detail::sum(first, static_cast<std::size_t>(last - first));
+#else
+  T total = T();
+  for (; first != last; ++first)
+    total += *first;
+  return total;
+#endif
+}
+
+
+template <typename T>
+std::ptrdiff_t count(T const* first, T const* last, T const& value)
+{
+#ifdef MRR_SIMD_ENABLED
+  std::size_t total = 0;
+  while (first != last)
+  {
+    std::size_t const n =
+      std::min<std::size_t>(last - first, detail::max_chunk);
+    total += detail::count(first, n, value);
+    first += n;
+  }
+  return static_cast<std::ptrdiff_t>(total);
+#else
+  return std::count(first,last,value);
+#endif
+}
+
+
+template <typename T>
+T const* max_element(T const* first, T const* last)
+{
+#ifdef MRR_SIMD_ENABLED
+  T const* best = last;
+  for (T const* chunk = first; chunk != last; )
+  {
+    std::size_t const n =
+      std::min<std::size_t>(last - chunk, detail::max_chunk);
+    std::ptrdiff_t const index = detail::extremum<T,true>(chunk, n);
+
+    if (index < 0)
+      return std::max_element(first,last);
+    if (best == last || *best < chunk[index])
+      best = chunk + index;
+
+    chunk += n;
+  }
+  return best;
+#else
+  return std::max_element(first,last);
+#endif
+}
+
+
+template <typename T>
+T const* min_element(T const* first, T const* last)
+{
+#ifdef MRR_SIMD_ENABLED
+  T const* best = last;
+  for (T const* chunk = first; chunk != last; )
+  {
+    std::size_t const n =
+      std::min<std::size_t>(last - chunk, detail::max_chunk);
+    std::ptrdiff_t const index = detail::extremum<T,false>(chunk, n);
+
+    if (index < 0)
+      return std::min_element(first,last);
+    if (best == last || chunk[index] < *best)
+      best = chunk + index;
+
+    chunk += n;
+  }
+  return best;
+#else
+  return std::min_element(first,last);
+#endif
+}
+
+
+//m----------------------------------------------------------------------
+} // namespace simd
+//-----------------------------------------------------------------------
+
+
+//m----------------------------------------------------------------------
+} // namespace mrr
+//-----------------------------------------------------------------------
+
+
+#endif // #ifndef MRR_CXX_UTILS_SIMD_HXX_
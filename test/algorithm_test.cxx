@@ -0,0 +1,348 @@
+// Compares the concurrent algorithms with their <algorithm>/<numeric>
+// equivalents on empty, single element, below-cutoff and odd-sized
+// ranges, with the default partitioner, with one that makes many tiny
+// blocks and with the static one.
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../algorithm.hxx"
+#include "../checked_iterator.hxx"
+#include "check.hxx"
+
+namespace {
+
+using mrr::concurrent::adaptive_partitioner;
+using mrr::concurrent::fixed_partitioner;
+using mrr::concurrent::static_partitioner;
+using mrr::concurrent::thread_pool;
+
+
+std::size_t const sizes[] = {
+  0, 1, 2, 15, 16, 17,
+  mrr::concurrent::default_sequential_cutoff - 1,
+  mrr::concurrent::default_sequential_cutoff + 1,
+  4097, 100003
+};
+
+
+std::vector<int> random_ints(std::size_t n, int max_value)
+{
+  std::mt19937 gen(static_cast<std::mt19937::result_type>(n));
+  std::uniform_int_distribution<int> dist(-max_value, max_value);
+
+  std::vector<int> v(n);
+  for (int& x : v)
+    x = dist(gen);
+  return v;
+}
+
+
+bool is_odd(int x)
+{
+  return x % 2 != 0;
+}
+
+
+// A result type without a default constructor, for the per-block
+// result slots.
+struct total
+{
+  explicit total(long long v) : value(v) {}
+  long long value;
+};
+
+total operator +(total const& a, total const& b)
+{
+  return total(a.value + b.value);
+}
+
+
+
+// Contiguous arithmetic ranges take the SIMD kernels, so run the
+// reductions over plain and checked iterators to a vector (SIMD) and
+// over a deque, which is not contiguous (scalar).
+template <typename Partitioner, typename Iterator>
+void test_reductions(
+  thread_pool& pool, Partitioner const& part, Iterator first, Iterator last
+)
+{
+  using value_type = typename std::iterator_traits<Iterator>::value_type;
+  value_type const target = first == last ? value_type() : *first;
+
+  CHECK(mrr::concurrent::accumulate(pool, part, first, last, value_type(3))
+        == std::accumulate(first, last, value_type(3)));
+  CHECK(mrr::concurrent::count(pool, part, first, last, target)
+        == std::count(first, last, target));
+  CHECK(mrr::concurrent::count_if(
+          pool, part, first, last, [](value_type x) { return x > 0; }
+        ) == std::count_if(first, last, [](value_type x) { return x > 0; }));
+  CHECK(mrr::concurrent::max_element(pool, part, first, last)
+        == std::max_element(first, last));
+  CHECK(mrr::concurrent::min_element(pool, part, first, last)
+        == std::min_element(first, last));
+}
+
+template <typename Partitioner>
+void test_reductions(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  std::vector<int> v = random_ints(n, 1000);
+  test_reductions(pool, part, v.begin(), v.end());
+  test_reductions(pool, part, mrr::make_checked(v), mrr::make_checked(v, v.end()));
+
+  std::vector<double> const d(v.begin(), v.end());
+  test_reductions(pool, part, d.begin(), d.end());
+
+  std::deque<int> const q(v.begin(), v.end());
+  test_reductions(pool, part, q.begin(), q.end());
+}
+
+
+// T cannot be initialized from a char, so this is summed sequentially
+// from init rather than from the first element of each block. Before
+// C++20 std::accumulate copies the string at every step, hence the cap.
+template <typename Partitioner>
+void test_accumulate_into(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  n = std::min<std::size_t>(n, 4097);
+  std::vector<char> v(n);
+  for (std::size_t i = 0; i != n; ++i)
+    v[i] = static_cast<char>('a' + i % 26);
+
+  std::string const init = "init:";
+  CHECK(mrr::concurrent::accumulate(pool, part, v.begin(), v.end(), init)
+        == std::accumulate(v.begin(), v.end(), init));
+}
+
+
+template <typename Partitioner>
+void test_modifying(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  std::vector<int> const v = random_ints(n, 3);
+
+  std::vector<int> out = v;
+  mrr::concurrent::fill(pool, part, out.begin(), out.end(), 9);
+  CHECK(std::count(out.begin(), out.end(), 9) == static_cast<std::ptrdiff_t>(n));
+
+  std::vector<int> expected = v;
+  for (int& x : expected)
+    x = x * 2 + 1;
+  out = v;
+  mrr::concurrent::for_each(pool, part, out.begin(), out.end(), [](int& x) { x = x * 2 + 1; });
+  CHECK(out == expected);
+
+  expected = v;
+  std::replace(expected.begin(), expected.end(), 1, 7);
+  out = v;
+  mrr::concurrent::replace(pool, part, out.begin(), out.end(), 1, 7);
+  CHECK(out == expected);
+
+  expected = v;
+  std::replace_if(expected.begin(), expected.end(), is_odd, 0);
+  out = v;
+  mrr::concurrent::replace_if(pool, part, out.begin(), out.end(), is_odd, 0);
+  CHECK(out == expected);
+}
+
+
+// An exception from any block is rethrown to the caller once all the
+// blocks have finished, and the pool stays usable.
+template <typename Partitioner>
+void test_exception(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  if (n == 0)
+    return;
+
+  std::vector<int> v(n, 0);
+  v[n - 1] = 1;
+
+  bool threw = false;
+  try
+  {
+    mrr::concurrent::for_each(pool, part, v.begin(), v.end(), [](int x) {
+      if (x == 1)
+        throw std::runtime_error("block failed");
+    });
+  }
+  catch (std::runtime_error const&)
+  {
+    threw = true;
+  }
+  CHECK(threw);
+
+  CHECK(mrr::concurrent::count(pool, part, v.begin(), v.end(), 1) == 1);
+}
+
+
+template <typename Partitioner>
+void test_transform_reduce(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  std::vector<int> const v = random_ints(n, 1000);
+  auto const square = [](int x) { return static_cast<long long>(x) * x; };
+
+  long long expected = 7;
+  for (int x : v)
+    expected += square(x);
+
+  CHECK(mrr::concurrent::transform_reduce(
+          pool, part, v.begin(), v.end(), 7LL, std::plus<long long>(), square
+        ) == expected);
+
+  CHECK(mrr::concurrent::transform_reduce(
+          pool, part, v.begin(), v.end(), total(7), std::plus<total>(),
+          [&](int x) { return total(square(x)); }
+        ).value == expected);
+}
+
+
+template <typename Partitioner>
+void test_scans(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  std::vector<int> const v = random_ints(n, 1000);
+
+  std::vector<long long> expected(n);
+  std::partial_sum(v.begin(), v.end(), expected.begin(), std::plus<long long>());
+
+  std::vector<long long> out(n, -1);
+  auto const inclusive_end = mrr::concurrent::inclusive_scan(
+    pool, part, v.begin(), v.end(), out.begin(), std::plus<long long>()
+  );
+  CHECK(inclusive_end == out.end());
+  CHECK(out == expected);
+
+  // Exclusive: init followed by the inclusive sums, less the last.
+  long long sum = 5;
+  for (std::size_t i = 0; i != n; ++i)
+  {
+    long long const x = v[i];
+    expected[i] = sum;
+    sum += x;
+  }
+
+  std::fill(out.begin(), out.end(), -1);
+  auto const exclusive_end = mrr::concurrent::exclusive_scan(
+    pool, part, v.begin(), v.end(), out.begin(), 5LL, std::plus<long long>()
+  );
+  CHECK(exclusive_end == out.end());
+  CHECK(out == expected);
+}
+
+
+template <typename Partitioner>
+void test_copy_if(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  std::vector<int> const v = random_ints(n, 1000);
+
+  std::vector<int> expected(n);
+  expected.erase(std::copy_if(v.begin(), v.end(), expected.begin(), is_odd), expected.end());
+
+  std::vector<int> out(n);
+  auto const out_end =
+    mrr::concurrent::copy_if(pool, part, v.begin(), v.end(), out.begin(), is_odd);
+  CHECK(out_end - out.begin() == static_cast<std::ptrdiff_t>(expected.size()));
+  out.erase(out_end, out.end());
+  CHECK(out == expected);
+}
+
+
+// The parallel partition is stable, so it must match stable_partition
+// exactly.
+template <typename Partitioner>
+void test_partition(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  std::vector<int> expected = random_ints(n, 1000);
+  std::vector<int> v = expected;
+
+  auto const expected_mid = std::stable_partition(expected.begin(), expected.end(), is_odd);
+  auto const mid = mrr::concurrent::partition(pool, part, v.begin(), v.end(), is_odd);
+
+  CHECK(mid - v.begin() == expected_mid - expected.begin());
+  CHECK(v == expected);
+}
+
+
+template <typename Partitioner>
+void test_sort(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  // Few distinct values, so there are plenty of equal keys.
+  std::vector<int> expected = random_ints(n, 50);
+  std::vector<int> v = expected;
+
+  std::sort(expected.begin(), expected.end(), std::greater<int>());
+  mrr::concurrent::sort(pool, part, v.begin(), v.end(), std::greater<int>());
+  CHECK(v == expected);
+
+  // Already sorted input.
+  mrr::concurrent::sort(pool, part, v.begin(), v.end(), std::greater<int>());
+  CHECK(v == expected);
+}
+
+
+template <typename Partitioner>
+void test_merge(thread_pool& pool, Partitioner const& part, std::size_t n)
+{
+  std::vector<int> a = random_ints(n, 1000);
+  std::vector<int> b = random_ints(n / 3 + 1, 1000);
+  std::sort(a.begin(), a.end());
+  std::sort(b.begin(), b.end());
+
+  std::vector<int> expected(a.size() + b.size());
+  std::merge(a.begin(), a.end(), b.begin(), b.end(), expected.begin());
+
+  std::vector<int> out(a.size() + b.size());
+  auto const out_end = mrr::concurrent::merge(
+    pool, part, a.begin(), a.end(), b.begin(), b.end(), out.begin(), std::less<int>()
+  );
+  CHECK(out_end == out.end());
+  CHECK(out == expected);
+
+  // And with the ranges swapped, one of them possibly empty.
+  std::vector<int> empty;
+  out.resize(a.size());
+  mrr::concurrent::merge(
+    pool, part, empty.begin(), empty.end(), a.begin(), a.end(), out.begin(), std::less<int>()
+  );
+  CHECK(out == a);
+}
+
+
+template <typename Partitioner>
+void test_all(thread_pool& pool, Partitioner const& part)
+{
+  for (std::size_t n : sizes)
+  {
+    test_reductions(pool, part, n);
+    test_accumulate_into(pool, part, n);
+    test_modifying(pool, part, n);
+    test_exception(pool, part, n);
+    test_transform_reduce(pool, part, n);
+    test_scans(pool, part, n);
+    test_copy_if(pool, part, n);
+    test_partition(pool, part, n);
+    test_sort(pool, part, n);
+    test_merge(pool, part, n);
+  }
+}
+
+} // namespace
+
+
+int main()
+{
+  thread_pool pool(3);
+
+  test_all(pool, adaptive_partitioner());
+  test_all(pool, fixed_partitioner(7, 16));
+  test_all(pool, static_partitioner());
+  test_all(pool, static_partitioner(0));
+
+  return mrr::test::check_status();
+}
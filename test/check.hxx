@@ -0,0 +1,51 @@
+#ifndef MRR_CXX_UTILS_TEST_CHECK_HXX_
+#define MRR_CXX_UTILS_TEST_CHECK_HXX_
+
+#include <iostream>
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Minimal checking for the tests. A failed CHECK prints where it failed
+// and carries on; the test's exit status is check_status().
+
+namespace mrr {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+namespace test {
+
+inline int& failures()
+{
+  static int count = 0;
+  return count;
+}
+
+inline void check(bool ok, char const* expr, char const* file, int line)
+{
+  if (!ok)
+  {
+    ++failures();
+    std::cerr << file << ':' << line << ": CHECK(" << expr << ") failed\n";
+  }
+}
+
+inline int check_status()
+{
+  if (failures() != 0)
+    std::cerr << failures() << " check(s) failed\n";
+  return failures() == 0 ? 0 : 1;
+}
+
+} // namespace test
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+} // namespace mrr
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+#define CHECK(expr) ::mrr::test::check((expr), #expr, __FILE__, __LINE__)
+
+
+#endif // MRR_CXX_UTILS_TEST_CHECK_HXX_
@@ -0,0 +1,181 @@
+// Checks that the throwing policies catch each kind of misuse, that the
+// sampled policy checks on schedule, that checked iterators over
+// contiguous storage are contiguous to the SIMD paths and, from C++20,
+// to std::to_address and std::span, including at end().
+
+#include <list>
+#include <stdexcept>
+#include <vector>
+
+#if __cplusplus > 201703L
+#  include <iterator>
+#  include <memory>
+#  include <span>
+#endif
+
+#include "../checked_iterator.hxx"
+#include "check.hxx"
+
+namespace {
+
+template <typename Func>
+bool throws_out_of_range(Func f)
+{
+  try
+  {
+    f();
+  }
+  catch (std::out_of_range const&)
+  {
+    return true;
+  }
+  return false;
+}
+
+
+void test_always_checked()
+{
+  std::vector<int> v = { 1, 2, 3 };
+  std::vector<int> other = { 4 };
+
+  auto const first = mrr::make_checked(v);
+  auto const last = mrr::make_checked(v, v.end());
+
+  CHECK(*first == 1);
+  CHECK(first[2] == 3);
+  CHECK(last - first == 3);
+  CHECK(last.index() == 3);
+
+  CHECK(throws_out_of_range([&]() { return *last; }));
+  CHECK(throws_out_of_range([&]() { return first[3]; }));
+  CHECK(throws_out_of_range([&]() { return first[-1]; }));
+  CHECK(throws_out_of_range([&]() { auto i = last; ++i; }));
+  CHECK(throws_out_of_range([&]() { auto i = first; --i; }));
+  CHECK(throws_out_of_range([&]() { return first + 4; }));
+  CHECK(throws_out_of_range([&]() { return last - 4; }));
+  CHECK(throws_out_of_range([&]() { return mrr::make_checked(v, other.begin()); }));
+  CHECK(throws_out_of_range([&]() { return first - mrr::make_checked(other); }));
+
+  // Moving to end() is fine, only going past it is not.
+  CHECK(first + 3 == last);
+  CHECK(last - 3 == first);
+}
+
+
+void test_sampled_checked()
+{
+  using policy = mrr::sampled_checked<4>;
+
+  std::vector<int> v = { 1, 2, 3, 4, 5 };
+  std::vector<int> other = { 6 };
+  auto const in_other = mrr::make_checked<policy>(other);
+
+  // The first operation is checked, then one in every four.
+  auto i = mrr::make_checked<policy>(v);
+  CHECK(throws_out_of_range([&]() { return i - in_other; }));
+  ++i;
+  ++i;
+  ++i;
+  CHECK(throws_out_of_range([&]() { return i - in_other; }));
+  CHECK(*i == 4);
+
+  // Construction is always validated.
+  CHECK(throws_out_of_range([&]() { return mrr::make_checked<policy>(v, other.begin()); }));
+}
+
+
+void test_debug_checked()
+{
+  std::vector<int> v = { 1 };
+  auto const last = mrr::make_checked<mrr::debug_checked>(v, v.end());
+
+#ifdef NDEBUG
+  CHECK(!mrr::debug_checked().check());
+#else
+  CHECK(throws_out_of_range([&]() { return *last; }));
+#endif
+  CHECK(last.index() == 1);
+}
+
+
+void test_checked_range()
+{
+  std::vector<int> v = { 1, 2, 3 };
+
+  auto const r = mrr::make_checked_range(v, v.begin() + 1, v.end());
+  CHECK(r.size() == 2);
+  CHECK(*r.begin() == 2);
+  CHECK(!r.empty());
+
+  CHECK(throws_out_of_range([&]() {
+    return mrr::make_checked_range(v, v.end(), v.begin());
+  }));
+}
+
+
+// Whether a checked iterator is contiguous follows the iterator it wraps.
+static_assert(
+  mrr::simd::is_contiguous_iterator<
+    mrr::checked_iterator<std::vector<int> >
+  >::value,
+  "checked vector iterators are contiguous"
+);
+static_assert(
+  mrr::simd::is_contiguous_iterator<
+    mrr::checked_iterator<std::vector<int>, std::vector<int>::iterator, mrr::sampled_checked<> >
+  >::value,
+  "checked vector iterators are contiguous whatever the policy"
+);
+static_assert(
+  !mrr::simd::is_contiguous_iterator<mrr::checked_iterator<std::list<int> > >::value,
+  "checked list iterators are not contiguous"
+);
+
+
+#if __cplusplus > 201703L
+
+static_assert(
+  std::contiguous_iterator<mrr::checked_iterator<std::vector<int> > >,
+  "checked vector iterators model contiguous_iterator"
+);
+
+void test_to_address()
+{
+  std::vector<int> v = { 1, 2, 3 };
+  auto const first = mrr::make_checked(v);
+  auto const last = mrr::make_checked(v, v.end());
+
+  CHECK(std::to_address(first) == v.data());
+  CHECK(std::to_address(last) == v.data() + v.size());
+
+  std::span<int> const s(first, last);
+  CHECK(s.data() == v.data());
+  CHECK(s.size() == 3);
+
+  // end() is begin() here; it has an address but cannot be dereferenced.
+  std::vector<int> empty;
+  auto const empty_first = mrr::make_checked(empty);
+  auto const empty_last = mrr::make_checked(empty, empty.end());
+
+  std::span<int> const none(empty_first, empty_last);
+  CHECK(none.empty());
+  CHECK(throws_out_of_range([&]() { return *empty_first; }));
+}
+
+#endif
+
+} // namespace
+
+
+int main()
+{
+  test_always_checked();
+  test_sampled_checked();
+  test_debug_checked();
+  test_checked_range();
+#if __cplusplus > 201703L
+  test_to_address();
+#endif
+
+  return mrr::test::check_status();
+}
@@ -0,0 +1,221 @@
+// Checks every reduction, and the batch operations on each, against
+// 128-bit arithmetic: N = 1, 2, 2^32 and 2^63 (mask), odd N either side
+// of 2^32 and near 2^64 (Montgomery), even N below 2^32 (Barrett) and
+// even N from 2^32 up to near 2^64 (wide Barrett).
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "../modulo.hxx"
+#include "check.hxx"
+
+namespace {
+
+__extension__ typedef unsigned __int128 wide_type;
+
+std::uint64_t const max64 = ~std::uint64_t(0);
+
+
+std::uint64_t ref_mul(std::uint64_t a, std::uint64_t b, std::uint64_t n)
+{
+  return static_cast<std::uint64_t>(static_cast<wide_type>(a % n) * (b % n) % n);
+}
+
+std::uint64_t ref_add(std::uint64_t a, std::uint64_t b, std::uint64_t n)
+{
+  return static_cast<std::uint64_t>((static_cast<wide_type>(a % n) + b % n) % n);
+}
+
+std::uint64_t ref_sub(std::uint64_t a, std::uint64_t b, std::uint64_t n)
+{
+  return static_cast<std::uint64_t>((static_cast<wide_type>(a % n) + n - b % n) % n);
+}
+
+std::uint64_t gcd(std::uint64_t a, std::uint64_t b)
+{
+  while (b != 0)
+  {
+    std::uint64_t const r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+
+// The edge values, then random 64-bit values and random residues.
+std::vector<std::uint64_t> sample_values(std::uint64_t n, std::mt19937_64& rng)
+{
+  std::vector<std::uint64_t> v = {
+    0, 1, 2, n - 1, n, n + 1, max64 - 1, max64,
+    n / 2, std::uint64_t(1) << 32, (std::uint64_t(1) << 32) - 1
+  };
+  for (int i = 0; i != 64; ++i)
+  {
+    v.push_back(rng());
+    v.push_back(rng() % n);
+  }
+  return v;
+}
+
+
+template <std::size_t N>
+void test_scalar(std::mt19937_64& rng)
+{
+  using mod = mrr::modulo<N>;
+  std::vector<std::uint64_t> const values = sample_values(N, rng);
+
+  for (std::uint64_t a : values)
+  {
+    mod const ma(a);
+    CHECK(static_cast<std::uint64_t>(ma) == a % N);
+
+    for (std::uint64_t b : values)
+    {
+      mod const mb(b);
+      CHECK(static_cast<std::uint64_t>(ma * mb) == ref_mul(a, b, N));
+      CHECK(static_cast<std::uint64_t>(ma + mb) == ref_add(a, b, N));
+      CHECK(static_cast<std::uint64_t>(ma - mb) == ref_sub(a, b, N));
+    }
+
+    std::uint64_t expected = 1 % N;
+    for (std::uint64_t e = 0; e != 5; ++e)
+    {
+      CHECK(static_cast<std::uint64_t>(ma.pow(e)) == expected);
+      expected = ref_mul(expected, a, N);
+    }
+
+    if (gcd(a % N, N) == 1)
+      CHECK(ma * ma.inverse() == 1);
+    else
+    {
+      bool threw = false;
+      try
+      {
+        ma.inverse();
+      }
+      catch (std::domain_error const&)
+      {
+        threw = true;
+      }
+      CHECK(threw);
+    }
+  }
+}
+
+
+template <std::size_t N>
+void test_batch(std::mt19937_64& rng)
+{
+  using mod = mrr::modulo<N>;
+
+  // Not a multiple of any vector width, so the scalar tail runs too.
+  std::vector<std::uint64_t> a = sample_values(N, rng);
+  std::vector<std::uint64_t> b = sample_values(N, rng);
+  a.resize(67);
+  b.resize(67);
+  std::reverse(b.begin(), b.end());
+
+  std::vector<mod> const ma(a.begin(), a.end());
+  std::vector<mod> const mb(b.begin(), b.end());
+  std::size_t const n = a.size();
+
+  std::vector<mod> out(n);
+
+  mrr::batch_add(ma.data(), ma.data() + n, mb.data(), out.data());
+  for (std::size_t i = 0; i != n; ++i)
+    CHECK(static_cast<std::uint64_t>(out[i]) == ref_add(a[i], b[i], N));
+
+  mrr::batch_sub(ma.data(), ma.data() + n, mb.data(), out.data());
+  for (std::size_t i = 0; i != n; ++i)
+    CHECK(static_cast<std::uint64_t>(out[i]) == ref_sub(a[i], b[i], N));
+
+  mrr::batch_mul(ma.data(), ma.data() + n, mb.data(), out.data());
+  for (std::size_t i = 0; i != n; ++i)
+    CHECK(static_cast<std::uint64_t>(out[i]) == ref_mul(a[i], b[i], N));
+
+  // In place, into the first input.
+  std::vector<mod> inout = ma;
+  mrr::batch_mul(inout.data(), inout.data() + n, mb.data(), inout.data());
+  CHECK(inout == out);
+
+  // Against one residue.
+  for (std::uint64_t c : { std::uint64_t(0), std::uint64_t(1), N - 1, b[7] })
+  {
+    mod const mc(c);
+
+    mrr::batch_add(ma.data(), ma.data() + n, mc, out.data());
+    for (std::size_t i = 0; i != n; ++i)
+      CHECK(static_cast<std::uint64_t>(out[i]) == ref_add(a[i], c, N));
+
+    mrr::batch_sub(ma.data(), ma.data() + n, mc, out.data());
+    for (std::size_t i = 0; i != n; ++i)
+      CHECK(static_cast<std::uint64_t>(out[i]) == ref_sub(a[i], c, N));
+
+    mrr::batch_mul(ma.data(), ma.data() + n, mc, out.data());
+    for (std::size_t i = 0; i != n; ++i)
+      CHECK(static_cast<std::uint64_t>(out[i]) == ref_mul(a[i], c, N));
+  }
+
+  // Empty ranges write nothing.
+  mrr::batch_mul(ma.data(), ma.data(), mb.data(), static_cast<mod*>(nullptr));
+}
+
+
+template <std::size_t N, typename Reduction>
+void test_modulus(std::mt19937_64& rng)
+{
+  static_assert(
+    std::is_same<typename mrr::modulo<N>::reduction, Reduction>::value,
+    "unexpected reduction"
+  );
+  test_scalar<N>(rng);
+  test_batch<N>(rng);
+}
+
+
+#if __cplusplus >= 201402L
+
+static_assert(mrr::modulo<998244353>(3).pow(998244352) == 1, "Fermat");
+static_assert(mrr::modulo<(std::uint64_t(1) << 40) + 2>(max64) == max64 % ((std::uint64_t(1) << 40) + 2), "wide Barrett");
+
+#endif
+
+} // namespace
+
+
+int main()
+{
+  using namespace mrr::detail;
+  std::uint64_t const two32 = std::uint64_t(1) << 32;
+
+  std::mt19937_64 rng(12345);
+
+  test_modulus<1, mask_reduction<1> >(rng);
+  test_modulus<2, mask_reduction<2> >(rng);
+  test_modulus<two32, mask_reduction<two32> >(rng);
+  test_modulus<std::uint64_t(1) << 63, mask_reduction<std::uint64_t(1) << 63> >(rng);
+
+  test_modulus<3, montgomery32_reduction<3> >(rng);
+  test_modulus<998244353, montgomery32_reduction<998244353> >(rng);
+  test_modulus<two32 - 1, montgomery32_reduction<two32 - 1> >(rng);
+  test_modulus<two32 + 1, montgomery64_reduction<two32 + 1> >(rng);
+  test_modulus<max64 - 58, montgomery64_reduction<max64 - 58> >(rng);
+  test_modulus<max64, montgomery64_reduction<max64> >(rng);
+
+  test_modulus<6, barrett_reduction<6> >(rng);
+  test_modulus<1000000006, barrett_reduction<1000000006> >(rng);
+  test_modulus<two32 - 2, barrett_reduction<two32 - 2> >(rng);
+
+  test_modulus<two32 + 2, wide_barrett_reduction<two32 + 2> >(rng);
+  test_modulus<(two32 - 1) * 6, wide_barrett_reduction<(two32 - 1) * 6> >(rng);
+  test_modulus<(std::uint64_t(1) << 63) + 2, wide_barrett_reduction<(std::uint64_t(1) << 63) + 2> >(rng);
+  test_modulus<max64 - 1, wide_barrett_reduction<max64 - 1> >(rng);
+
+  return mrr::test::check_status();
+}
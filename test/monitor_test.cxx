@@ -0,0 +1,187 @@
+// Runs concurrent readers and writers on each monitor variant. Writers
+// keep the two fields of a point equal, so a reader seeing them differ
+// has seen a torn or unsynchronized update, and the final count shows
+// whether any write was lost. Also checks that async_monitor runs
+// every queued function before its destructor returns.
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../monitor.hxx"
+#include "check.hxx"
+
+namespace {
+
+struct point
+{
+  long x;
+  long y;
+};
+
+
+unsigned const num_writers = 3;
+unsigned const num_readers = 3;
+long const writes_per_thread = 2000;
+long const reads_per_thread = 2000;
+
+
+// write() increments the point once; read() returns it.
+template <typename Write, typename Read>
+void run_readers_and_writers(Write write, Read read)
+{
+  std::atomic<bool> torn(false);
+  std::vector<std::thread> threads;
+
+  for (unsigned i = 0; i != num_writers; ++i)
+    threads.emplace_back([&]() {
+      for (long n = 0; n != writes_per_thread; ++n)
+        write();
+    });
+
+  for (unsigned i = 0; i != num_readers; ++i)
+    threads.emplace_back([&]() {
+      for (long n = 0; n != reads_per_thread; ++n)
+      {
+        point const p = read();
+        if (p.x != p.y)
+          torn = true;
+      }
+    });
+
+  for (std::thread& t : threads)
+    t.join();
+
+  CHECK(!torn);
+
+  point const last = read();
+  CHECK(last.x == num_writers * writes_per_thread);
+  CHECK(last.y == last.x);
+}
+
+
+void bump(point& p)
+{
+  ++p.x;
+  ++p.y;
+}
+
+
+void test_monitor()
+{
+  mrr::monitor<point> m(point{0, 0});
+  run_readers_and_writers(
+    [&]() { m(bump); },
+    [&]() { return m([](point& p) { return p; }); }
+  );
+  CHECK(m.object().x == num_writers * writes_per_thread);
+}
+
+
+#if __cplusplus >= 201402L
+
+void test_shared_monitor()
+{
+  mrr::shared_monitor<point> m(point{0, 0});
+  run_readers_and_writers(
+    [&]() { m.write(bump); },
+    [&]() { return m.read([](point const& p) { return p; }); }
+  );
+
+  // operator() picks the lock from the function's parameter.
+  m(bump);
+  CHECK(m([](point const& p) { return p.x; }) == num_writers * writes_per_thread + 1);
+}
+
+#endif
+
+
+void test_seqlock_monitor()
+{
+  mrr::seqlock_monitor<point> m(point{0, 0});
+  run_readers_and_writers(
+    [&]() { m.update(bump); },
+    [&]() { return m.load(); }
+  );
+
+  m.store(point{5, 5});
+  CHECK(m([](point const& p) { return p.x + p.y; }) == 10);
+}
+
+
+void test_rcu_monitor()
+{
+  mrr::rcu_monitor<point> m(point{0, 0});
+  run_readers_and_writers(
+    [&]() { m.update(bump); },
+    [&]() { return m([](point const& p) { return p; }); }
+  );
+
+  // A snapshot is unaffected by later writes.
+  std::shared_ptr<point const> const before = m.snapshot();
+  m.store(point{-1, -1});
+  CHECK(before->x == num_writers * writes_per_thread);
+  CHECK(m.object().x == -1);
+}
+
+
+void test_async_monitor()
+{
+  mrr::async_monitor<point> m(point{0, 0});
+  run_readers_and_writers(
+    [&]() { m(bump).get(); },
+    [&]() { return m([](point& p) { return p; }).get(); }
+  );
+
+  // Exceptions come back through the future.
+  std::future<int> failed = m([](point&) -> int { throw std::runtime_error("failed"); });
+  bool threw = false;
+  try
+  {
+    failed.get();
+  }
+  catch (std::runtime_error const&)
+  {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+
+// Functions still queued when the monitor is destroyed all run, in
+// order, before the destructor returns.
+void test_async_monitor_drains()
+{
+  long const calls = 10000;
+  std::vector<long> seen;
+
+  {
+    mrr::async_monitor<std::vector<long>*> m(&seen);
+    for (long i = 0; i != calls; ++i)
+      m([i](std::vector<long>* s) { s->push_back(i); });
+  }
+
+  CHECK(static_cast<long>(seen.size()) == calls);
+  bool in_order = true;
+  for (long i = 0; i != static_cast<long>(seen.size()); ++i)
+    in_order = in_order && seen[i] == i;
+  CHECK(in_order);
+}
+
+} // namespace
+
+
+int main()
+{
+  test_monitor();
+#if __cplusplus >= 201402L
+  test_shared_monitor();
+#endif
+  test_seqlock_monitor();
+  test_rcu_monitor();
+  test_async_monitor();
+  test_async_monitor_drains();
+
+  return mrr::test::check_status();
+}
@@ -0,0 +1,96 @@
+// Traces nested zones from several threads into a ring buffer small
+// enough to be overwritten, and checks the Chrome trace holds only
+// whole zones and that exited threads' buffers are freed once drained.
+//
+// A traced algorithm runs first, so the default pool is created before
+// the trace registry and its workers retire their buffers during static
+// destruction. The test is built with AddressSanitizer, which catches a
+// registry destroyed before them.
+
+#define MRR_TRACE
+#define MRR_TRACE_BUFFER_EVENTS 64
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../algorithm.hxx"
+#include "../trace.hxx"
+#include "check.hxx"
+
+namespace {
+
+void nested(int depth)
+{
+  MRR_TRACE_SCOPE_ARG("nested", "depth", depth);
+  if (depth != 0)
+    nested(depth - 1);
+}
+
+
+std::size_t count(std::string const& s, std::string const& what)
+{
+  std::size_t n = 0;
+  for (std::size_t i = s.find(what); i != std::string::npos; i = s.find(what, i + 1))
+    ++n;
+  return n;
+}
+
+} // namespace
+
+
+int main()
+{
+  using mrr::trace::registry;
+
+  // Large enough to be split into blocks on the default pool's workers.
+  std::vector<int> const ones(std::size_t(1) << 20, 1);
+  for (int i = 0; i != 20; ++i)
+    CHECK(mrr::concurrent::accumulate(ones.begin(), ones.end(), 0)
+          == static_cast<int>(ones.size()));
+
+  // Drop the algorithm's zones. Its threads, this one included, keep
+  // their buffers.
+  std::ostringstream discarded;
+  mrr::trace::write_chrome_trace(discarded);
+  std::size_t const live_buffers = registry::instance().size();
+  CHECK(live_buffers >= 1);
+
+  std::size_t const num_threads = 4;
+  std::size_t const zones_per_thread = 200 * 8;
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t != num_threads; ++t)
+    threads.emplace_back([]() {
+      for (int i = 0; i != 200; ++i)
+        nested(7);
+    });
+  for (std::thread& t : threads)
+    t.join();
+
+  CHECK(registry::instance().size() == live_buffers + num_threads);
+
+  std::ostringstream os;
+  mrr::trace::write_chrome_trace(os);
+  std::string const json = os.str();
+
+  // Every event is a complete zone; each thread kept at most a ring's
+  // worth of them.
+  std::size_t const events = count(json, "{\"ph\":");
+  CHECK(events == count(json, "{\"ph\":\"X\""));
+  CHECK(events == count(json, "\"dur\":"));
+  CHECK(events > 0);
+  CHECK(events <= num_threads * MRR_TRACE_BUFFER_EVENTS);
+  CHECK(events < num_threads * zones_per_thread);
+
+  // The threads have exited and been drained, so their buffers are gone;
+  // live threads keep theirs across drains.
+  CHECK(registry::instance().size() == live_buffers);
+  nested(0);
+  mrr::trace::write_chrome_trace(os);
+  CHECK(registry::instance().size() == live_buffers);
+
+  return mrr::test::check_status();
+}
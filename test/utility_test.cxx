@@ -0,0 +1,267 @@
+// Checks the charconv conversions and discard in utility.hxx, and the
+// tokenizer over buffers, streams read in blocks of every size (so
+// fields straddle refills and outgrow the block), both separator scans,
+// and empty mapped files.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../tokenizer.hxx"
+#include "../utility.hxx"
+#include "check.hxx"
+
+namespace {
+
+template <typename Exception, typename Func>
+bool throws(Func f)
+{
+  try
+  {
+    f();
+  }
+  catch (Exception const&)
+  {
+    return true;
+  }
+  return false;
+}
+
+
+void test_to_string()
+{
+  char buffer[4];
+  CHECK(mrr::to_string(123, buffer) == "123");
+  CHECK(mrr::to_string(-12, buffer) == "-12");
+  CHECK(throws<std::length_error>([&]() { return mrr::to_string(12345, buffer); }));
+  CHECK(throws<std::length_error>([&]() { return mrr::to_string(-1234, buffer); }));
+  CHECK(throws<std::length_error>([&]() { return mrr::to_string(1, buffer, buffer); }));
+
+  CHECK(mrr::to_string(std::numeric_limits<long long>::min()) == "-9223372036854775808");
+  CHECK(mrr::to_string(std::numeric_limits<unsigned long long>::max()) == "18446744073709551615");
+  CHECK(mrr::to_string('x') == "x");
+  CHECK(mrr::to_string(std::string("s")) == "s");
+}
+
+
+void test_from_string()
+{
+  CHECK(mrr::from_string<int>("42") == 42);
+  CHECK(mrr::from_string<int>("-42") == -42);
+  CHECK(mrr::from_string<short>("32767") == 32767);
+
+  CHECK(throws<std::out_of_range>([]() { return mrr::from_string<short>("32768"); }));
+  CHECK(throws<std::out_of_range>([]() { return mrr::from_string<int>("99999999999"); }));
+  CHECK(throws<std::invalid_argument>([]() { return mrr::from_string<int>("12x"); }));
+  CHECK(throws<std::invalid_argument>([]() { return mrr::from_string<int>("12 "); }));
+  CHECK(throws<std::invalid_argument>([]() { return mrr::from_string<int>(" 12"); }));
+  CHECK(throws<std::invalid_argument>([]() { return mrr::from_string<int>(""); }));
+  CHECK(throws<std::invalid_argument>([]() { return mrr::from_string<unsigned>("-1"); }));
+
+  // The non-throwing form leaves value alone on failure.
+  int value = 7;
+  CHECK(!mrr::from_string("256x", value));
+  CHECK(!mrr::from_string("99999999999", value));
+  CHECK(value == 7);
+  CHECK(mrr::from_string("-3", value));
+  CHECK(value == -3);
+}
+
+
+void test_discard()
+{
+  // A non-numeric token is skipped without failing, unlike operator>>.
+  std::istringstream is("abc 5");
+  mrr::discard<int>(is);
+  CHECK(is.good());
+  int x = 0;
+  is >> x;
+  CHECK(x == 5);
+  CHECK(!is.fail());
+
+  // A token running into the end of the stream sets only eofbit, as
+  // reading it would.
+  std::istringstream last("1 22");
+  mrr::discard<int>(last);
+  mrr::discard<int>(last);
+  CHECK(last.eof());
+  CHECK(!last.fail());
+
+  // Nothing left but whitespace: eofbit and failbit.
+  std::istringstream blank("7   ");
+  mrr::discard<int>(blank);
+  CHECK(blank.good());
+  mrr::discard<int>(blank);
+  CHECK(blank.eof());
+  CHECK(blank.fail());
+
+  std::istringstream empty("");
+  mrr::discard<std::string>(empty);
+  CHECK(empty.eof());
+  CHECK(empty.fail());
+
+  // The stream's character type skips one character, whitespace or not
+  // once the sentry has skipped leading whitespace.
+  std::istringstream chars("  ab");
+  mrr::discard<char>(chars);
+  char c = 0;
+  chars >> c;
+  CHECK(c == 'b');
+
+  std::istringstream buffered("abc");
+  mrr::discard_input(buffered);
+  CHECK(buffered.get() == std::char_traits<char>::eof());
+}
+
+
+typedef std::vector<std::pair<std::string, bool> > fields;
+
+// Every field with whether it ended its record, split by hand.
+fields split(std::string_view text, std::string_view delimiters)
+{
+  fields result;
+  std::string field;
+  for (char c : text)
+    if (c == '\n' || delimiters.find(c) != std::string_view::npos)
+    {
+      result.emplace_back(field, c == '\n');
+      field.clear();
+    }
+    else
+      field.push_back(c);
+
+  if (!field.empty())
+    result.emplace_back(field, true);
+  return result;
+}
+
+fields tokenize(mrr::tokenizer& tok)
+{
+  fields result;
+  std::string_view field;
+  while (tok.next(field))
+    result.emplace_back(std::string(field), tok.end_of_record());
+  return result;
+}
+
+
+void test_tokenizer(std::string const& text, std::string_view delimiters)
+{
+  fields const expected = split(text, delimiters);
+
+  mrr::tokenizer buffer_tok(text, delimiters);
+  CHECK(tokenize(buffer_tok) == expected);
+
+  // Block sizes from one byte, smaller than most fields, to more than
+  // the whole text.
+  for (std::size_t block = 1; block <= text.size() + 1; block += block < 40 ? 1 : 37)
+  {
+    std::istringstream is(text);
+    mrr::tokenizer stream_tok(is, delimiters, '\n', block);
+    CHECK(tokenize(stream_tok) == expected);
+  }
+}
+
+
+void test_tokenizer()
+{
+  std::string const long_field(300, 'x');
+  std::string const text =
+    "a,b,c\n"
+    ",,\n"
+    "\n"
+    "0123456789abcdef0123456789abcdef,1,2\n"
+    + long_field + "," + long_field + "\n"
+    "one;two|three\tfour,five\n"
+    "last,record,without newline";
+
+  // Up to three delimiters take the vector scan, more the table lookup.
+  test_tokenizer(text, ",");
+  test_tokenizer(text, ",;|");
+  test_tokenizer(text, ",;|\t");
+  test_tokenizer(text, "");
+
+  // A final record without a newline still ends its record.
+  mrr::tokenizer tok(std::string_view("x,y"));
+  std::string_view field;
+  CHECK(tok.next(field) && field == "x" && !tok.end_of_record());
+  CHECK(tok.next(field) && field == "y" && tok.end_of_record());
+  CHECK(!tok.next(field));
+
+  // skip_record drops the rest of a header line.
+  mrr::tokenizer header(std::string_view("h1,h2,h3\nv1,v2\n"));
+  CHECK(header.next(field) && field == "h1");
+  header.skip_record();
+  CHECK(header.next(field) && field == "v1");
+
+  mrr::tokenizer empty(std::string_view(""));
+  CHECK(!empty.next(field));
+
+  std::istringstream empty_stream("");
+  mrr::tokenizer empty_stream_tok(empty_stream, ",", '\n', 4);
+  CHECK(!empty_stream_tok.next(field));
+}
+
+
+#ifdef MRR_TOKENIZER_MMAP
+
+void test_mapped_file()
+{
+  char path[] = "/tmp/mrr_utility_test_XXXXXX";
+  int const fd = ::mkstemp(path);
+  CHECK(fd >= 0);
+  ::close(fd);
+
+  {
+    mrr::mapped_file const empty(path);
+    CHECK(empty.size() == 0);
+    CHECK(empty.view().empty());
+
+    mrr::tokenizer tok(empty.view());
+    std::string_view field;
+    CHECK(!tok.next(field));
+  }
+
+  std::FILE* const f = std::fopen(path, "w");
+  std::fputs("1,2\n3", f);
+  std::fclose(f);
+
+  {
+    mrr::mapped_file file(path);
+    mrr::mapped_file moved(std::move(file));
+    CHECK(file.size() == 0);
+
+    mrr::tokenizer tok(moved.view());
+    CHECK(tokenize(tok) == split("1,2\n3", ","));
+  }
+
+  std::remove(path);
+
+  CHECK(throws<std::system_error>([&]() { return mrr::mapped_file(path); }));
+}
+
+#endif
+
+} // namespace
+
+
+int main()
+{
+  test_to_string();
+  test_from_string();
+  test_discard();
+  test_tokenizer();
+#ifdef MRR_TOKENIZER_MMAP
+  test_mapped_file();
+#endif
+
+  return mrr::test::check_status();
+}
@@ -0,0 +1,305 @@
+//===========================================================================
+// Copyright (c) 2012 Matt Renaud. All Rights Reserved.
+//
+//===========================================================================
+
+#ifndef MRR_CONCURRENT_THREAD_POOL_HXX_
+#define MRR_CONCURRENT_THREAD_POOL_HXX_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+namespace mrr {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Concurrent Algorithms.
+
+namespace concurrent {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Work-stealing thread pool.
+//
+// Each worker owns a deque of tasks. A worker pushes and pops its own
+// work at the front and, when it runs dry, steals from the back of the
+// other workers' deques. Tasks submitted from outside the pool are
+// dealt out to the workers round-robin.
+class thread_pool
+{
+public:
+  using task_type = std::function<void()>;
+
+  // One worker per hardware thread, less the thread submitting the work.
+  static unsigned default_size()
+  {
+    unsigned const hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 1u;
+  }
+
+  explicit thread_pool(unsigned num_workers = default_size())
+    : stop_(false), pending_(0), next_queue_(0)
+  {
+    num_workers = std::max(1u, num_workers);
+
+    for (unsigned i = 0; i != num_workers; ++i)
+      queues_.emplace_back(new work_queue);
+
+    for (unsigned i = 0; i != num_workers; ++i)
+      workers_.emplace_back(&thread_pool::worker_loop, this, i);
+  }
+
+  thread_pool(thread_pool const&) = delete;
+  thread_pool(thread_pool&&) = delete;
+  thread_pool& operator =(thread_pool const&) = delete;
+  thread_pool& operator =(thread_pool&&) = delete;
+
+  ~thread_pool()
+  {
+    {
+      std::lock_guard<std::mutex> guard{wake_m_};
+      stop_ = true;
+    }
+    wake_cv_.notify_all();
+
+    for (std::thread& t : workers_)
+      t.join();
+  }
+
+  unsigned size() const
+  {
+    return static_cast<unsigned>(queues_.size());
+  }
+
+  // Queue a task for execution. Called from a worker the task goes on
+  // that worker's own deque so it stays cache-warm.
+  void submit(task_type task)
+  {
+    worker_id const& self = this_worker();
+    unsigned const index = (self.pool == this)
+      ? self.index
+      : next_queue_.fetch_add(1, std::memory_order_relaxed) % size();
+
+    // Count the task before publishing it: a worker may pop it, and
+    // decrement pending_, as soon as the queue lock is released.
+    {
+      std::lock_guard<std::mutex> guard{wake_m_};
+      ++pending_;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard{queues_[index]->m};
+      queues_[index]->tasks.push_front(std::move(task));
+    }
+    wake_cv_.notify_one();
+  }
+
+  // Run a single queued task on the calling thread, if there is one.
+  // Used by threads that are waiting on work so they help rather than
+  // block.
+  bool run_pending_task()
+  {
+    task_type task;
+    if (!try_pop(task))
+      return false;
+
+    task();
+    return true;
+  }
+
+private:
+  struct work_queue
+  {
+    std::mutex m;
+    std::deque<task_type> tasks;
+  };
+
+  struct worker_id
+  {
+    thread_pool const* pool;
+    unsigned index;
+  };
+
+  static worker_id& this_worker()
+  {
+    static thread_local worker_id id{nullptr, 0};
+    return id;
+  }
+
+  bool try_pop(task_type& task)
+  {
+    worker_id const& self = this_worker();
+    unsigned const num_queues = size();
+    unsigned const home = (self.pool == this) ? self.index : 0;
+
+    if (self.pool == this && pop_front(*queues_[home], task))
+      return true;
+
+    for (unsigned i = 0; i != num_queues; ++i)
+      if (steal_back(*queues_[(home + i) % num_queues], task))
+        return true;
+
+    return false;
+  }
+
+  bool pop_front(work_queue& q, task_type& task)
+  {
+    std::lock_guard<std::mutex> guard{q.m};
+    if (q.tasks.empty())
+      return false;
+
+    task = std::move(q.tasks.front());
+    q.tasks.pop_front();
+    --pending_;
+    return true;
+  }
+
+  bool steal_back(work_queue& q, task_type& task)
+  {
+    std::lock_guard<std::mutex> guard{q.m};
+    if (q.tasks.empty())
+      return false;
+
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    --pending_;
+    return true;
+  }
+
+  void worker_loop(unsigned index)
+  {
+    this_worker() = worker_id{this, index};
+
+    for (;;)
+    {
+      if (run_pending_task())
+        continue;
+
+      std::unique_lock<std::mutex> lock{wake_m_};
+      wake_cv_.wait(lock, [this] { return stop_ || pending_ > 0; });
+
+      if (stop_ && pending_ == 0)
+        return;
+    }
+  }
+
+  std::vector<std::unique_ptr<work_queue> > queues_;
+  std::vector<std::thread> workers_;
+
+  std::mutex wake_m_;
+  std::condition_variable wake_cv_;
+  bool stop_;
+  std::atomic<std::size_t> pending_;
+  std::atomic<unsigned> next_queue_;
+};
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// A set of tasks on a pool that can be waited on together. The waiting
+// thread executes queued tasks while it waits, so a task may itself
+// start and wait on a task_group without deadlocking the pool. The
+// first exception thrown by a task is rethrown from wait().
+class task_group
+{
+public:
+  explicit task_group(thread_pool& pool)
+    : pool_(pool), outstanding_(0)
+  {
+  }
+
+  task_group(task_group const&) = delete;
+  task_group(task_group&&) = delete;
+  task_group& operator =(task_group const&) = delete;
+  task_group& operator =(task_group&&) = delete;
+
+  ~task_group()
+  {
+    help_until_done();
+  }
+
+  template <typename Func>
+  void run(Func&& func)
+  {
+    ++outstanding_;
+
+    typename std::decay<Func>::type f(std::forward<Func>(func));
+    pool_.submit([this, f]() {
+      try
+      {
+        f();
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> guard{error_m_};
+        if (!error_)
+          error_ = std::current_exception();
+      }
+      --outstanding_;
+    });
+  }
+
+  void wait()
+  {
+    help_until_done();
+
+    if (error_)
+    {
+      std::exception_ptr e = error_;
+      error_ = nullptr;
+      std::rethrow_exception(e);
+    }
+  }
+
+private:
+  void help_until_done()
+  {
+    while (outstanding_ > 0)
+      if (!pool_.run_pending_task())
+        std::this_thread::yield();
+  }
+
+  thread_pool& pool_;
+  std::atomic<std::size_t> outstanding_;
+  std::mutex error_m_;
+  std::exception_ptr error_;
+};
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// The process-wide pool used by the concurrent algorithms when no pool
+// is given explicitly. Created on first use.
+inline thread_pool& default_pool()
+{
+  static thread_pool pool;
+  return pool;
+}
+
+
+//m----------------------------------------------------------------------
+} // namespace concurrent
+//-----------------------------------------------------------------------
+
+
+//m----------------------------------------------------------------------
+} // namespace mrr
+//-----------------------------------------------------------------------
+
+
+#endif // #ifndef MRR_CONCURRENT_THREAD_POOL_HXX_
@@ -0,0 +1,325 @@
+#ifndef MRR_CXX_UTILS_TOKENIZER_HXX_
+#define MRR_CXX_UTILS_TOKENIZER_HXX_
+
+#if __cplusplus < 201703L
+#  error "tokenizer.hxx requires C++17 (std::string_view)"
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "simd.hxx"
+
+// The separator scan compares 16 bytes at a time and finds the first hit
+// from the bytes of two 64-bit words, which needs little endian.
+#if defined(MRR_SIMD_ENABLED) && defined(__BYTE_ORDER__) \
+    && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define MRR_TOKENIZER_SIMD 1
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#  define MRR_TOKENIZER_MMAP 1
+#endif
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+namespace mrr {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+#ifdef MRR_TOKENIZER_MMAP
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// A whole file mapped read-only into memory. Throws std::system_error
+// if the file cannot be opened or mapped.
+class mapped_file
+{
+public:
+  explicit mapped_file(std::string const& path)
+    : data_(nullptr), size_(0)
+  {
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::system_error(errno, std::generic_category(), "open " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+      int const error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "fstat " + path);
+    }
+
+    size_ = static_cast<std::size_t>(st.st_size);
+
+    // mmap rejects empty mappings; an empty file is just an empty view.
+    if (size_ != 0)
+    {
+      void* const p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED)
+      {
+        int const error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "mmap " + path);
+      }
+
+      data_ = static_cast<char const*>(p);
+      ::madvise(p, size_, MADV_SEQUENTIAL);
+    }
+
+    ::close(fd);
+  }
+
+  mapped_file(mapped_file const&) = delete;
+  mapped_file& operator =(mapped_file const&) = delete;
+
+  mapped_file(mapped_file&& other) noexcept
+    : data_(other.data_), size_(other.size_)
+  {
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+
+  mapped_file& operator =(mapped_file&& other) noexcept
+  {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  ~mapped_file()
+  {
+    if (data_ != nullptr)
+      ::munmap(const_cast<char*>(data_), size_);
+  }
+
+  char const* data() const
+  {
+    return data_;
+  }
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  std::string_view view() const
+  {
+    return std::string_view(data_, size_);
+  }
+
+private:
+  char const* data_;
+  std::size_t size_;
+};
+
+#endif // #ifdef MRR_TOKENIZER_MMAP
+
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Splits input into fields separated by any of a set of delimiter
+// characters, grouped into records ending at record_end (by default
+// comma separated fields, one record per line). Fields are string_views
+// into the input, nothing is copied.
+//
+// The input is either a buffer that outlives the tokenizer (a string or
+// a mapped_file) or a stream read in large blocks. With a stream the
+// fields only stay valid until the next call to next().
+//
+//   mapped_file file("data.csv");
+//   tokenizer tok(file.view());
+//   std::string_view field;
+//   while (tok.next(field))
+//     ... tok.end_of_record() ...
+class tokenizer
+{
+public:
+  static std::size_t const default_block_size = std::size_t(1) << 20;
+
+  explicit tokenizer(
+    std::string_view text,
+    std::string_view delimiters = ",",
+    char record_end = '\n'
+  )
+    : is_(nullptr), first_(text.data()), last_(text.data() + text.size()),
+      scanned_(first_), record_end_(record_end), at_record_end_(false)
+  {
+    set_delimiters(delimiters);
+  }
+
+  explicit tokenizer(
+    std::istream& is,
+    std::string_view delimiters = ",",
+    char record_end = '\n',
+    std::size_t block_size = default_block_size
+  )
+    : is_(&is), buffer_(std::max<std::size_t>(block_size, 1)),
+      first_(buffer_.data()), last_(buffer_.data()), scanned_(first_),
+      record_end_(record_end), at_record_end_(false)
+  {
+    set_delimiters(delimiters);
+  }
+
+  tokenizer(tokenizer const&) = delete;
+  tokenizer& operator =(tokenizer const&) = delete;
+
+  // The next field, or false when the input is exhausted. A final record
+  // without a trailing record_end still yields its fields.
+  bool next(std::string_view& field)
+  {
+    for (;;)
+    {
+      char const* const sep = find_separator(scanned_, last_);
+
+      if (sep != last_)
+      {
+        field = std::string_view(first_, static_cast<std::size_t>(sep - first_));
+        at_record_end_ = (*sep == record_end_);
+        first_ = scanned_ = sep + 1;
+        return true;
+      }
+
+      scanned_ = last_;
+      if (!refill())
+        break;
+    }
+
+    if (first_ == last_)
+      return false;
+
+    field = std::string_view(first_, static_cast<std::size_t>(last_ - first_));
+    at_record_end_ = true;
+    first_ = scanned_ = last_;
+    return true;
+  }
+
+  // Whether the field last returned by next() ended its record.
+  bool end_of_record() const
+  {
+    return at_record_end_;
+  }
+
+  // Skip the rest of the current record, e.g. a header line before
+  // the first field is read.
+  void skip_record()
+  {
+    std::string_view field;
+    while (!at_record_end_ && next(field))
+      ;
+  }
+
+private:
+  void set_delimiters(std::string_view delimiters)
+  {
+    std::fill(std::begin(is_separator_), std::end(is_separator_), false);
+    for (char c : delimiters)
+      is_separator_[static_cast<unsigned char>(c)] = true;
+    is_separator_[static_cast<unsigned char>(record_end_)] = true;
+
+#ifdef MRR_TOKENIZER_SIMD
+    // Unused slots repeat record_end so every slot can be compared.
+    num_separators_ = delimiters.size() + 1;
+    for (std::size_t i = 0; i != max_vector_separators; ++i)
+    {
+      char const c = i < delimiters.size() ? delimiters[i] : record_end_;
+      for (std::size_t lane = 0; lane != sizeof(bytes); ++lane)
+        separators_[i][lane] = static_cast<unsigned char>(c);
+    }
+#endif
+  }
+
+  char const* find_separator(char const* p, char const* last) const
+  {
+#ifdef MRR_TOKENIZER_SIMD
+    if (num_separators_ <= max_vector_separators)
+    {
+      for (; last - p >= static_cast<std::ptrdiff_t>(sizeof(bytes)); p += sizeof(bytes))
+      {
+        bytes chunk;
+        std::memcpy(&chunk, p, sizeof(bytes));
+
+        bytes hits = (bytes)(chunk == separators_[0]);
+        for (std::size_t i = 1; i != max_vector_separators; ++i)
+          hits |= (bytes)(chunk == separators_[i]);
+
+        words const w = (words)hits;
+        if (w[0] != 0)
+          return p + __builtin_ctzll(w[0]) / 8;
+        if (w[1] != 0)
+          return p + 8 + __builtin_ctzll(w[1]) / 8;
+      }
+    }
+#endif
+
+    while (p != last && !is_separator_[static_cast<unsigned char>(*p)])
+      ++p;
+    return p;
+  }
+
+  // Keep the partial field at the front of the buffer, grow the buffer if
+  // the field fills it, and read another block after it.
+  bool refill()
+  {
+    if (is_ == nullptr || !*is_)
+      return false;
+
+    std::size_t const partial = static_cast<std::size_t>(last_ - first_);
+    std::memmove(buffer_.data(), first_, partial);
+
+    if (partial > buffer_.size() / 2)
+      buffer_.resize(buffer_.size() * 2);
+
+    is_->read(buffer_.data() + partial, static_cast<std::streamsize>(buffer_.size() - partial));
+    std::size_t const count = static_cast<std::size_t>(is_->gcount());
+
+    first_ = buffer_.data();
+    scanned_ = first_ + partial;
+    last_ = scanned_ + count;
+    return count != 0;
+  }
+
+  std::istream* is_;
+  std::vector<char> buffer_;
+  char const* first_;
+  char const* last_;
+  char const* scanned_;
+  char record_end_;
+  bool at_record_end_;
+  bool is_separator_[256];
+
+#ifdef MRR_TOKENIZER_SIMD
+  typedef unsigned char bytes __attribute__((vector_size(16)));
+  typedef std::uint64_t words __attribute__((vector_size(16)));
+
+  static std::size_t const max_vector_separators = 4;
+
+  std::size_t num_separators_;
+  bytes separators_[max_vector_separators];
+#endif
+};
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+} // namespace mrr
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+#endif // MRR_CXX_UTILS_TOKENIZER_HXX_
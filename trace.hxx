@@ -0,0 +1,497 @@
+#ifndef MRR_CXX_UTILS_TRACE_HXX_
+#define MRR_CXX_UTILS_TRACE_HXX_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "scope_guard.hxx"
+
+// Scoped trace zones are only recorded when MRR_TRACE is defined.
+// Otherwise the MRR_TRACE_* macros expand to nothing and the
+// instrumented code is exactly as if they were not there.
+#if defined(MRR_TRACE)
+#  define MRR_TRACE_ENABLED 1
+#endif
+
+// Number of events each thread's ring buffer holds. Must be a power of
+// two. When a thread records more than this between flushes its oldest
+// events are overwritten.
+#ifndef MRR_TRACE_BUFFER_EVENTS
+#  define MRR_TRACE_BUFFER_EVENTS 8192
+#endif
+
+#define MRR_TRACE_CAT_(a, b) a##b
+#define MRR_TRACE_CAT(a, b) MRR_TRACE_CAT_(a, b)
+
+#if defined(MRR_TRACE_ENABLED)
+#  define MRR_TRACE_SCOPE(name)                                      \
+     auto MRR_TRACE_CAT(mrr_trace_zone_, __LINE__) =                 \
+       ::mrr::trace::zone(name)
+#  define MRR_TRACE_SCOPE_ARG(name, arg_name, arg)                   \
+     auto MRR_TRACE_CAT(mrr_trace_zone_, __LINE__) =                 \
+       ::mrr::trace::zone(name, arg_name, arg)
+#else
+#  define MRR_TRACE_SCOPE(name)
+#  define MRR_TRACE_SCOPE_ARG(name, arg_name, arg)
+#endif
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+namespace mrr {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Scoped tracing.
+//
+// Every thread records one complete event per zone, when the zone ends,
+// into its own fixed size ring buffer, so recording a zone never
+// allocates or takes a lock (the buffer is allocated the first time a
+// thread records anything). An overwritten zone is lost as a whole, so
+// the trace never has a begin without its end. Names are not copied and
+// must be string literals. The buffers are drained into Chrome
+// trace_event JSON, which Perfetto and chrome://tracing can load, either
+// on demand or periodically by a trace_flusher.
+
+namespace trace {
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+using clock_type = std::chrono::steady_clock;
+
+
+// A zone that started at ns and lasted dur nanoseconds.
+struct event
+{
+  char const* name;
+  char const* arg_name;
+  std::int64_t arg;
+  std::uint64_t ns;
+  std::uint64_t dur;
+};
+
+
+
+// Single producer ring buffer. Only the owning thread records; only one
+// flush drains it at a time. The slots are read like a seqlock: the
+// producer announces the index it is about to overwrite before writing
+// the slot, and the reader throws away anything that was announced
+// while it was reading.
+class ring_buffer
+{
+public:
+  static std::size_t const capacity = MRR_TRACE_BUFFER_EVENTS;
+
+  static_assert(
+    capacity != 0 && (capacity & (capacity - 1)) == 0,
+    "MRR_TRACE_BUFFER_EVENTS must be a power of two"
+  );
+
+  explicit ring_buffer(unsigned tid)
+    : tid_(tid), next_(0), begun_(0), head_(0), tail_(0), retired_(false),
+      slots_(capacity)
+  {
+  }
+
+  unsigned tid() const
+  {
+    return tid_;
+  }
+
+  // Called by the owning thread as it exits; nothing more is recorded.
+  void retire()
+  {
+    retired_.store(true, std::memory_order_release);
+  }
+
+  bool retired() const
+  {
+    return retired_.load(std::memory_order_acquire);
+  }
+
+  void record(
+    char const* name, char const* arg_name, std::int64_t arg,
+    std::uint64_t ns, std::uint64_t dur
+  )
+  {
+    std::uint64_t const i = next_++;
+    slot& s = slots_[i & (capacity - 1)];
+
+    begun_.store(i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s.name.store(name, std::memory_order_relaxed);
+    s.arg_name.store(arg_name, std::memory_order_relaxed);
+    s.arg.store(arg, std::memory_order_relaxed);
+    s.ns.store(ns, std::memory_order_relaxed);
+    s.dur.store(dur, std::memory_order_relaxed);
+
+    head_.store(i + 1, std::memory_order_release);
+  }
+
+  // Call f(event) for each event recorded since the last drain that has
+  // not been overwritten since.
+  template <typename Func>
+  void drain(Func f)
+  {
+    std::uint64_t const head = head_.load(std::memory_order_acquire);
+    std::uint64_t i =
+      std::max(tail_, head > capacity ? head - capacity : std::uint64_t(0));
+
+    for(; i != head; ++i)
+    {
+      slot const& s = slots_[i & (capacity - 1)];
+
+      event e;
+      e.name = s.name.load(std::memory_order_relaxed);
+      e.arg_name = s.arg_name.load(std::memory_order_relaxed);
+      e.arg = s.arg.load(std::memory_order_relaxed);
+      e.ns = s.ns.load(std::memory_order_relaxed);
+      e.dur = s.dur.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(begun_.load(std::memory_order_relaxed) > i + capacity)
+        continue;
+
+      f(e);
+    }
+
+    tail_ = head;
+  }
+
+private:
+  struct slot
+  {
+    std::atomic<char const*> name;
+    std::atomic<char const*> arg_name;
+    std::atomic<std::int64_t> arg;
+    std::atomic<std::uint64_t> ns;
+    std::atomic<std::uint64_t> dur;
+  };
+
+  unsigned tid_;
+  std::uint64_t next_;
+  std::atomic<std::uint64_t> begun_;
+  std::atomic<std::uint64_t> head_;
+  std::uint64_t tail_;
+  std::atomic<bool> retired_;
+  std::vector<slot> slots_;
+};
+
+
+
+// Owns every thread's ring buffer. A buffer outlives its thread until
+// it has been drained once more, so zones recorded by threads that have
+// since exited are still flushed, and is freed then.
+//
+// The registry itself is never destroyed: threads owned by other static
+// objects, such as the workers of concurrent::default_pool(), may exit
+// and retire their buffers after static destruction has begun.
+class registry
+{
+public:
+  static registry& instance()
+  {
+    static registry* const r = new registry;
+    return *r;
+  }
+
+  clock_type::time_point epoch() const
+  {
+    return epoch_;
+  }
+
+  // Number of buffers held, including those of exited threads that
+  // have not been drained since.
+  std::size_t size()
+  {
+    std::lock_guard<std::mutex> guard{m_};
+    return buffers_.size();
+  }
+
+  ring_buffer* add()
+  {
+    std::lock_guard<std::mutex> guard{m_};
+    buffers_.emplace_back(new ring_buffer(++last_tid_));
+    return buffers_.back().get();
+  }
+
+  template <typename Func>
+  void drain(Func f)
+  {
+    std::lock_guard<std::mutex> guard{m_};
+    for(auto i = buffers_.begin(); i != buffers_.end(); )
+    {
+      // Checked before draining: once retired, this drain sees all the
+      // thread ever recorded.
+      bool const retired = (*i)->retired();
+
+      unsigned const tid = (*i)->tid();
+      (*i)->drain([&](event const& e) { f(tid, e); });
+
+      if(retired)
+        i = buffers_.erase(i);
+      else
+        ++i;
+    }
+  }
+
+private:
+  registry()
+    : epoch_(clock_type::now()), last_tid_(0)
+  {
+  }
+
+  std::mutex m_;
+  clock_type::time_point epoch_;
+  unsigned last_tid_;
+  std::vector<std::unique_ptr<ring_buffer> > buffers_;
+};
+
+
+
+// The calling thread's buffer, retired when the thread exits.
+class local_buffer_handle
+{
+public:
+  local_buffer_handle()
+    : buffer_(registry::instance().add())
+  {
+  }
+
+  local_buffer_handle(local_buffer_handle const&) = delete;
+  local_buffer_handle& operator =(local_buffer_handle const&) = delete;
+
+  ~local_buffer_handle()
+  {
+    buffer_->retire();
+  }
+
+  ring_buffer& buffer() const
+  {
+    return *buffer_;
+  }
+
+private:
+  ring_buffer* buffer_;
+};
+
+
+inline ring_buffer& local_buffer()
+{
+  static thread_local local_buffer_handle handle;
+  return handle.buffer();
+}
+
+
+inline std::uint64_t now_ns()
+{
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+
+  return static_cast<std::uint64_t>(
+    duration_cast<nanoseconds>(clock_type::now() - registry::instance().epoch()).count()
+  );
+}
+
+
+// Record a zone that started at start_ns (from now_ns()) and ends now.
+inline void complete(
+  char const* name, char const* arg_name, std::int64_t arg, std::uint64_t start_ns
+)
+{
+  std::uint64_t const end_ns = now_ns();
+  local_buffer().record(name, arg_name, arg, start_ns, end_ns - start_ns);
+}
+
+
+struct end_zone
+{
+  char const* name;
+  char const* arg_name;
+  std::int64_t arg;
+  std::uint64_t start_ns;
+
+  void operator ()() const
+  {
+    complete(name, arg_name, arg, start_ns);
+  }
+};
+
+
+// Notes the time now and records the zone when the returned guard goes
+// out of scope.
+inline scope_guard<end_zone> zone(
+  char const* name, char const* arg_name = nullptr, std::int64_t arg = 0
+)
+{
+  end_zone const e = { name, arg_name, arg, now_ns() };
+  return scope_guard<end_zone>(e);
+}
+
+
+
+// Writes drained events in Chrome's JSON array format. The closing
+// bracket is written when the writer is destroyed, but the viewers also
+// accept a file cut short, e.g. by a crash, without one.
+class chrome_trace_writer
+{
+public:
+  explicit chrome_trace_writer(std::ostream& os)
+    : os_(os), first_(true)
+  {
+    os_ << "[\n";
+  }
+
+  chrome_trace_writer(chrome_trace_writer const&) = delete;
+  chrome_trace_writer& operator =(chrome_trace_writer const&) = delete;
+
+  ~chrome_trace_writer()
+  {
+    flush();
+    os_ << "\n]\n";
+    os_.flush();
+  }
+
+  // Write everything recorded by any thread since the last flush.
+  void flush()
+  {
+    std::lock_guard<std::mutex> guard{m_};
+
+    std::ios_base::fmtflags const flags = os_.flags();
+    std::streamsize const precision = os_.precision();
+    os_.setf(std::ios_base::fixed, std::ios_base::floatfield);
+    os_.precision(3);
+
+    registry::instance().drain([this](unsigned tid, event const& e) {
+      write(tid, e);
+    });
+
+    os_.flags(flags);
+    os_.precision(precision);
+    os_.flush();
+  }
+
+private:
+  void write(unsigned tid, event const& e)
+  {
+    if(!first_)
+      os_ << ",\n";
+    first_ = false;
+
+    os_ << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+        << ",\"ts\":" << static_cast<double>(e.ns) / 1000.0
+        << ",\"dur\":" << static_cast<double>(e.dur) / 1000.0
+        << ",\"name\":";
+    write_string(e.name);
+
+    if(e.arg_name)
+    {
+      os_ << ",\"args\":{";
+      write_string(e.arg_name);
+      os_ << ':' << e.arg << '}';
+    }
+
+    os_ << '}';
+  }
+
+  void write_string(char const* s)
+  {
+    os_ << '"';
+    for(; *s; ++s)
+    {
+      if(*s == '"' || *s == '\\')
+        os_ << '\\';
+      os_ << *s;
+    }
+    os_ << '"';
+  }
+
+  std::mutex m_;
+  std::ostream& os_;
+  bool first_;
+};
+
+
+
+// Flushes a writer every period on a background thread, and a last time
+// when destroyed.
+class trace_flusher
+{
+public:
+  template <typename Rep, typename Period>
+  trace_flusher(
+    chrome_trace_writer& writer,
+    std::chrono::duration<Rep,Period> period
+  )
+    : writer_(writer), done_(false),
+      thread_([this, period]() {
+        std::unique_lock<std::mutex> lock{m_};
+        while(!cv_.wait_for(lock, period, [this]() { return done_; }))
+        {
+          lock.unlock();
+          writer_.flush();
+          lock.lock();
+        }
+      })
+  {
+  }
+
+  trace_flusher(trace_flusher const&) = delete;
+  trace_flusher& operator =(trace_flusher const&) = delete;
+
+  ~trace_flusher()
+  {
+    {
+      std::lock_guard<std::mutex> guard{m_};
+      done_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    writer_.flush();
+  }
+
+private:
+  chrome_trace_writer& writer_;
+  std::mutex m_;
+  std::condition_variable cv_;
+  bool done_;
+  std::thread thread_;
+};
+
+
+
+// Write everything recorded since the last flush as a complete trace.
+inline void write_chrome_trace(std::ostream& os)
+{
+  chrome_trace_writer writer(os);
+}
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+} // namespace trace
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+} // namespace mrr
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+
+#endif // MRR_CXX_UTILS_TRACE_HXX_
@@ -2,7 +2,26 @@
 #define MRR_CXX_UTILS_UTILITLY_HXX_
 
 #include <ios>
+#include <istream>
+#include <limits>
+#include <locale>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// std::to_chars and std::from_chars are C++17. Floating point support
+// came later than integer support, and is advertised by
+// __cpp_lib_to_chars.
+#if __cplusplus >= 201703L
+#  include <charconv>
+#  include <string_view>
+#  include <system_error>
+#  define MRR_UTILITY_CHARCONV 1
+#  if defined(__cpp_lib_to_chars)
+#    define MRR_UTILITY_CHARCONV_FLOAT 1
+#  endif
+#endif
 
 
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
@@ -11,36 +30,170 @@ namespace mrr {
 
 //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
+#ifdef MRR_UTILITY_CHARCONV
+
+//m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Allocation free conversions.
+//
+// These use std::to_chars and std::from_chars: no locale, no stream and
+// nothing allocated. Integers always work, floating point types when
+// the standard library supports them.
+
+namespace detail {
+
+// Streams write these as characters, so they are left to to_string(T).
+template <typename T>
+struct is_character
+  : std::integral_constant<
+      bool,
+      std::is_same<T, bool>::value
+        || std::is_same<T, char>::value
+        || std::is_same<T, signed char>::value
+        || std::is_same<T, unsigned char>::value
+        || std::is_same<T, wchar_t>::value
+        || std::is_same<T, char16_t>::value
+        || std::is_same<T, char32_t>::value
+    >
+{
+};
+
+template <typename T>
+struct is_charconv
+  : std::integral_constant<
+      bool,
+      (std::is_integral<T>::value && !is_character<T>::value)
+#ifdef MRR_UTILITY_CHARCONV_FLOAT
+        || std::is_floating_point<T>::value
+#endif
+    >
+{
+};
+
+} // namespace detail
+
+
+// Write value into [first,last) and return the characters written.
+// Throws std::length_error if it does not fit.
+template <typename T>
+auto to_string(T const& value, char* first, char* last)
+  -> typename std::enable_if<detail::is_charconv<T>::value, std::string_view>::type
+{
+  std::to_chars_result const r = std::to_chars(first, last, value);
+  if (r.ec != std::errc())
+    throw std::length_error("to_string: buffer too small");
+
+  return std::string_view(first, static_cast<std::size_t>(r.ptr - first));
+}
+
+template <typename T, std::size_t N>
+auto to_string(T const& value, char (&buffer)[N])
+  -> typename std::enable_if<detail::is_charconv<T>::value, std::string_view>::type
+{
+  return to_string(value, buffer, buffer + N);
+}
+
+
+// Parse all of s as a T. Returns false, leaving value alone, if s is
+// not exactly one T or the T is out of range.
+template <typename T>
+auto from_string(std::string_view s, T& value)
+  -> typename std::enable_if<detail::is_charconv<T>::value, bool>::type
+{
+  T parsed;
+  std::from_chars_result const r = std::from_chars(s.data(), s.data() + s.size(), parsed);
+  if (r.ec != std::errc() || r.ptr != s.data() + s.size())
+    return false;
+
+  value = parsed;
+  return true;
+}
+
+// As above, but throws like std::stoi: std::invalid_argument if s is
+// not a T and std::out_of_range if it does not fit in one.
+template <typename T>
+auto from_string(std::string_view s)
+  -> typename std::enable_if<detail::is_charconv<T>::value, T>::type
+{
+  T value;
+  std::from_chars_result const r = std::from_chars(s.data(), s.data() + s.size(), value);
+  if (r.ec == std::errc::result_out_of_range)
+    throw std::out_of_range("from_string: value out of range");
+  if (r.ec != std::errc() || r.ptr != s.data() + s.size())
+    throw std::invalid_argument("from_string: invalid value");
+
+  return value;
+}
+
+#endif // #ifdef MRR_UTILITY_CHARCONV
+
+
+
+// Skips the next whitespace delimited token (or the next character when
+// T is the stream's character type) without constructing a T. Sets
+// failbit if there is nothing left to skip, like operator>> would.
 template <typename T, typename Char, typename Traits>
 auto discard(std::basic_istream<Char,Traits>& is)
   -> std::basic_istream<Char,Traits>&
 {
-  T t;
-  is >> t;
+  typename std::basic_istream<Char,Traits>::sentry const s(is);
+  if (!s)
+    return is;
+
+  std::basic_streambuf<Char,Traits>* const buf = is.rdbuf();
+  std::ctype<Char> const& ctype = std::use_facet<std::ctype<Char> >(is.getloc());
+  typename Traits::int_type c = buf->sgetc();
+
+  if (std::is_same<T, Char>::value)
+  {
+    buf->sbumpc();
+    return is;
+  }
+
+  std::streamsize skipped = 0;
+  while (!Traits::eq_int_type(c, Traits::eof())
+         && !ctype.is(std::ctype_base::space, Traits::to_char_type(c)))
+  {
+    c = buf->snextc();
+    ++skipped;
+  }
+
+  if (Traits::eq_int_type(c, Traits::eof()))
+    is.setstate(skipped == 0 ? std::ios_base::eofbit | std::ios_base::failbit
+                             : std::ios_base::eofbit);
   return is;
 }
 
+// Integers are formatted with std::to_chars where it is available.
 template <typename T>
 std::string to_string(T const& t)
 {
+#ifdef MRR_UTILITY_CHARCONV
+  if constexpr (std::is_integral<T>::value && detail::is_charconv<T>::value)
+  {
+    char buffer[std::numeric_limits<T>::digits10 + 3];
+    return std::string(to_string(t, buffer));
+  }
+#endif
+
   std::stringstream ss;
   ss << t;
   return ss.str();
 }
 
+// Throws away everything already buffered in the stream in one call.
 template <typename Ch, typename Tr>
 std::basic_istream<Ch,Tr>& discard_input(std::basic_istream<Ch,Tr>& is)
 {
   std::streamsize const available_chars = is.rdbuf()->in_avail();
 
   if (available_chars > 0)
-    for (std::streamsize pos = 0; pos != available_chars; ++pos)
-      is.get();
+    is.ignore(available_chars);
 
   return is;
 }
 
 
+
 //m=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
 } // namespace mrr